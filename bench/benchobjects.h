@@ -0,0 +1,202 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+#ifndef BENCHOBJECTS_H
+#define BENCHOBJECTS_H
+
+#include <QObject>
+#include <QVector>
+#include "src/jenson.h"
+
+//
+// Object graph fixtures of the benchmark workloads, modeled on the test objects.
+// Nested objects and list items are owned by their parent object.
+//
+
+class BenchLeaf : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(qreal, x)
+    JENSON_PROPERTY_GETSET(qreal, y)
+    JENSON_PROPERTY_GETSET(QString, label)
+
+public:
+    Q_INVOKABLE BenchLeaf() : _x(0), _y(0) {}
+};
+SERIALIZABLE(BenchLeaf, bLeaf)
+
+class BenchNode : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(QString, name)
+    JENSON_PROPERTY_GETSET(qreal, value)
+    Q_PROPERTY(BenchLeaf* leaf READ leaf WRITE setLeaf RESET resetLeaf)
+    Q_PROPERTY(BenchNode* child READ child WRITE setChild RESET resetChild)
+    Q_PROPERTY(QVariantList children READ children WRITE setChildren)
+
+private:
+    BenchLeaf *_leaf;
+    BenchNode *_child;
+    QList<QObject*> _children;
+
+    template <typename T>
+    void adopt(T **member, T *value)
+    {
+        if (*member == value)
+            return;
+        delete *member;
+        *member = value;
+        if (value)
+            value->setParent(this);
+    }
+
+public:
+    Q_INVOKABLE BenchNode() : _value(0), _leaf(nullptr), _child(nullptr) {}
+
+    BenchLeaf* leaf() const { return _leaf; }
+    void setLeaf(BenchLeaf *leaf) { adopt(&_leaf, leaf); }
+    void resetLeaf() { setLeaf(nullptr); }
+
+    BenchNode* child() const { return _child; }
+    void setChild(BenchNode *child) { adopt(&_child, child); }
+    void resetChild() { setChild(nullptr); }
+
+    QVariantList children() const
+    {
+        QVariantList retVal;
+        foreach (QObject *item, _children)
+            retVal.append(QVariant::fromValue(item));
+        return retVal;
+    }
+    void setChildren(const QVariantList &children)
+    {
+        qDeleteAll(_children);
+        _children.clear();
+        foreach (const QVariant &item, children)
+        {
+            QObject *obj = qvariant_cast<QObject*>(item);
+            if (!obj)
+                continue;
+            obj->setParent(this);
+            _children.append(obj);
+        }
+    }
+    void appendChild(QObject *child) { child->setParent(this); _children.append(child); }
+};
+SERIALIZABLE(BenchNode, bNode)
+
+// Many scalar properties per object
+class BenchWide : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(qreal, d0) JENSON_PROPERTY_GETSET(qreal, d1) JENSON_PROPERTY_GETSET(qreal, d2)
+    JENSON_PROPERTY_GETSET(qreal, d3) JENSON_PROPERTY_GETSET(qreal, d4) JENSON_PROPERTY_GETSET(qreal, d5)
+    JENSON_PROPERTY_GETSET(qreal, d6) JENSON_PROPERTY_GETSET(qreal, d7)
+    JENSON_PROPERTY_GETSET(int, i0) JENSON_PROPERTY_GETSET(int, i1) JENSON_PROPERTY_GETSET(int, i2)
+    JENSON_PROPERTY_GETSET(int, i3) JENSON_PROPERTY_GETSET(int, i4) JENSON_PROPERTY_GETSET(int, i5)
+    JENSON_PROPERTY_GETSET(int, i6) JENSON_PROPERTY_GETSET(int, i7)
+    JENSON_PROPERTY_GETSET(QString, s0) JENSON_PROPERTY_GETSET(QString, s1) JENSON_PROPERTY_GETSET(QString, s2)
+    JENSON_PROPERTY_GETSET(QString, s3)
+    JENSON_PROPERTY_GETSET(bool, b0) JENSON_PROPERTY_GETSET(bool, b1)
+
+public:
+    Q_INVOKABLE BenchWide()
+        : _d0(0), _d1(0), _d2(0), _d3(0), _d4(0), _d5(0), _d6(0), _d7(0),
+          _i0(0), _i1(0), _i2(0), _i3(0), _i4(0), _i5(0), _i6(0), _i7(0),
+          _b0(false), _b1(false) {}
+};
+SERIALIZABLE(BenchWide, bWide)
+
+class BenchNumeric : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(QVector<double>, samples)
+    JENSON_PROPERTY_GETSET(QVector<float>, weights)
+    JENSON_PROPERTY_GETSET(QVector<int>, indices)
+    JENSON_PROPERTY_GETSET(qreal, scale)
+
+public:
+    Q_INVOKABLE BenchNumeric() : _scale(1) {}
+};
+SERIALIZABLE(BenchNumeric, bNumeric)
+
+// Serialized through a custom serializer, like CustomSerializable in the tests
+class BenchCustom : public QObject
+{
+    Q_OBJECT
+
+public:
+    qreal x;
+    qreal y;
+
+    BenchCustom() : x(0), y(0) {}
+};
+
+class BenchCustomSerializer : public jenson::JenSON::CustomSerializer<BenchCustom>
+{
+protected:
+    virtual QJsonValue serializeImpl(const BenchCustom *object) const override
+    {
+        QJsonObject retVal;
+        retVal.insert("x", object->x);
+        retVal.insert("y", object->y);
+        return retVal;
+    }
+    virtual sptr<BenchCustom> deserializeImpl(const QJsonValue *jsonValue, QString* /*unused*/) const override
+    {
+        sptr<BenchCustom> retVal(new BenchCustom());
+        retVal->x = jsonValue->toObject().value("x").toDouble();
+        retVal->y = jsonValue->toObject().value("y").toDouble();
+        return retVal;
+    }
+};
+CUSTOMSERIALIZABLE(BenchCustom, BenchCustomSerializer, bCustom)
+
+class BenchCustomHolder : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(BenchCustom* custom READ custom WRITE setCustom)
+    JENSON_PROPERTY_GETSET(int, id)
+
+private:
+    BenchCustom *_custom;
+
+public:
+    Q_INVOKABLE BenchCustomHolder() : _id(0) { _custom = new BenchCustom(); _custom->setParent(this); }
+
+    BenchCustom* custom() const { return _custom; }
+    void setCustom(BenchCustom *custom)
+    {
+        if (custom == _custom)
+            return;
+        delete _custom;
+        _custom = custom;
+        _custom->setParent(this);
+    }
+};
+SERIALIZABLE(BenchCustomHolder, bCustomHolder)
+
+#endif // BENCHOBJECTS_H
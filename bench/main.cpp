@@ -0,0 +1,372 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+#include <cmath>
+#include <functional>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QStringList>
+#include <QTextStream>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "benchobjects.h"
+
+using namespace jenson;
+
+
+// Heap allocation counts of jenson::AllocationScope, covers operator new (QObjects and their private data),
+// Qt containers allocate their payload with malloc and are not counted
+JENSON_TRACK_HEAP_ALLOCATIONS
+
+
+namespace
+{
+    //
+    // Workloads
+    //
+
+    BenchLeaf* newLeaf(int i)
+    {
+        BenchLeaf *leaf = new BenchLeaf();
+        leaf->setx(i * 0.25);
+        leaf->sety(1.0 / (i + 3));
+        leaf->setlabel(QString("leaf %1").arg(i));
+        return leaf;
+    }
+
+    BenchNode* newNode(int i)
+    {
+        BenchNode *node = new BenchNode();
+        node->setname(QString("node %1").arg(i));
+        node->setvalue(i * 1.5 + 0.1);
+        node->setLeaf(newLeaf(i));
+        return node;
+    }
+
+    // A chain of nested objects
+    QObject* buildDeep()
+    {
+        BenchNode *root = newNode(0);
+        BenchNode *node = root;
+        for (int i = 1; i < 256; i++)
+        {
+            BenchNode *child = newNode(i);
+            node->setChild(child);
+            node = child;
+        }
+        return root;
+    }
+
+    // Objects with many scalar properties
+    QObject* buildWide()
+    {
+        BenchNode *root = newNode(0);
+        for (int i = 0; i < 500; i++)
+        {
+            BenchWide *wide = new BenchWide();
+            wide->setd0(i * 0.1); wide->setd1(i * 0.2); wide->setd2(i * 0.3); wide->setd3(i * 0.4);
+            wide->setd4(i * 0.5); wide->setd5(i * 0.6); wide->setd6(i * 0.7); wide->setd7(i * 0.8);
+            wide->seti0(i); wide->seti1(i * 2); wide->seti2(i * 3); wide->seti3(i * 4);
+            wide->seti4(-i); wide->seti5(i % 7); wide->seti6(i << 8); wide->seti7(i * i);
+            wide->sets0("alpha"); wide->sets1(QString::number(i)); wide->sets2("gamma \"quoted\""); wide->sets3("");
+            wide->setb0(i % 2 == 0); wide->setb1(true);
+            root->appendChild(wide);
+        }
+        return root;
+    }
+
+    // Lists of lists of small objects
+    QObject* buildLists()
+    {
+        BenchNode *root = newNode(0);
+        for (int i = 0; i < 64; i++)
+        {
+            BenchNode *node = newNode(i);
+            for (int j = 0; j < 32; j++)
+                node->appendChild(newLeaf(i * 32 + j));
+            root->appendChild(node);
+        }
+        return root;
+    }
+
+    // Objects written by a custom serializer
+    QObject* buildCustom()
+    {
+        BenchNode *root = newNode(0);
+        for (int i = 0; i < 2000; i++)
+        {
+            BenchCustomHolder *holder = new BenchCustomHolder();
+            holder->setid(i);
+            holder->custom()->x = i * 0.5;
+            holder->custom()->y = -i * 0.25;
+            root->appendChild(holder);
+        }
+        return root;
+    }
+
+    // Large numeric arrays
+    QObject* buildNumeric()
+    {
+        BenchNode *root = newNode(0);
+        for (int i = 0; i < 16; i++)
+        {
+            BenchNumeric *numeric = new BenchNumeric();
+            QVector<double> samples(4096);
+            QVector<float> weights(1024);
+            QVector<int> indices(1024);
+            for (int j = 0; j < samples.count(); j++)
+                samples[j] = std::sin(j * 0.01 + i) * 1000.0;
+            for (int j = 0; j < weights.count(); j++)
+            {
+                weights[j] = float(j) / 1024.0f;
+                indices[j] = j * 7 - 3000;
+            }
+            numeric->setsamples(samples);
+            numeric->setweights(weights);
+            numeric->setindices(indices);
+            numeric->setscale(i + 0.5);
+            root->appendChild(numeric);
+        }
+        return root;
+    }
+
+    struct Workload
+    {
+        const char *name;
+        QObject* (*build)();
+    };
+
+    const Workload workloads[] =
+    {
+        { "deep", buildDeep },
+        { "wide", buildWide },
+        { "lists", buildLists },
+        { "custom", buildCustom },
+        { "numeric", buildNumeric }
+    };
+
+
+    //
+    // Serialization APIs
+    //
+
+    struct Api
+    {
+        const char *name;
+        std::function<void(const QObject*, QByteArray*)> write;
+        std::function<sptr<QObject>(const QByteArray&)> read;
+    };
+
+    QList<Api> apis()
+    {
+        QList<Api> retVal;
+
+        Api stream = { "stream",
+                       [](const QObject *obj, QByteArray *out) { JenSON::serialize(obj, out); },
+                       [](const QByteArray &data) { return JenSON::deserializeFrom(data); } };
+        retVal.append(stream);
+
+        Api dom = { "dom",
+                    [](const QObject *obj, QByteArray *out) { out->append(QJsonDocument(JenSON::serialize(obj)).toJson(QJsonDocument::Compact)); },
+                    [](const QByteArray &data) -> sptr<QObject> { QJsonObject json = QJsonDocument::fromJson(data).object(); return JenSON::deserializeToObject(&json); } };
+        retVal.append(dom);
+
+#ifdef JENSON_CBOR
+        Api cbor = { "cbor",
+                     [](const QObject *obj, QByteArray *out) { JenSON::serialize(obj, out, JenSON::Cbor); },
+                     [](const QByteArray &data) { return JenSON::deserializeFrom(data, JenSON::Cbor); } };
+        retVal.append(cbor);
+#endif
+
+        return retVal;
+    }
+
+
+    //
+    // Measurement
+    //
+
+    struct Measurement
+    {
+        qint64 iterations;
+        qint64 nsecs;
+        AllocationStats stats;
+    };
+
+    // Runs op until minTimeMs of op time is spent.
+    // Deleted graphs are freed between the runs, outside the timing.
+    Measurement measure(const std::function<void()> &op, qint64 minTimeMs)
+    {
+        // Warm up the class plans and caches
+        op();
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+        Measurement m = { 0, 0, AllocationStats() };
+        QElapsedTimer timer;
+        while (m.nsecs < minTimeMs * 1000000)
+        {
+            {
+                AllocationScope scope;
+                timer.start();
+                op();
+                m.nsecs += timer.nsecsElapsed();
+                m.stats += scope.total();
+            }
+            m.iterations++;
+
+            QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+        }
+
+        return m;
+    }
+
+    qint64 peakRssKiB()
+    {
+#ifdef Q_OS_UNIX
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef Q_OS_MAC
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+#else
+        return -1;
+#endif
+    }
+
+    QJsonObject result(const QString &workload, const QString &api, const QString &operation,
+                       const Measurement &m, int payloadBytes)
+    {
+        const double seconds = m.nsecs / 1e9;
+
+        QJsonObject retVal;
+        retVal.insert("workload", workload);
+        retVal.insert("api", api);
+        retVal.insert("operation", operation);
+        retVal.insert("iterations", double(m.iterations));
+        retVal.insert("seconds", seconds);
+        retVal.insert("opsPerSecond", m.iterations / seconds);
+        retVal.insert("bytesPerOp", payloadBytes);
+        retVal.insert("bytesPerSecond", double(payloadBytes) * m.iterations / seconds);
+        retVal.insert("allocationsPerOp", double(m.stats.allocations) / m.iterations);
+        retVal.insert("allocatedBytesPerOp", double(m.stats.allocatedBytes) / m.iterations);
+        if (AllocationScope::isInstrumented())
+        {
+            retVal.insert("objectsPerOp", double(m.stats.objects) / m.iterations);
+            retVal.insert("variantsPerOp", double(m.stats.variants) / m.iterations);
+            retVal.insert("jsonValuesPerOp", double(m.stats.jsonValues) / m.iterations);
+        }
+        retVal.insert("peakRssKiB", double(peakRssKiB()));
+        return retVal;
+    }
+}
+
+
+//
+// jenson-bench [--min-time <ms>] [--filter <text>]
+//
+// Prints a Json document with a result per workload/api/operation to stdout,
+// progress is reported on stderr.
+//
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    qint64 minTimeMs = 1000;
+    QString filter;
+
+    const QStringList args = app.arguments();
+    for (int i = 1; i < args.count(); i++)
+    {
+        if (args.at(i) == "--min-time" && i + 1 < args.count())
+        {
+            minTimeMs = args.at(++i).toLongLong();
+        }
+        else if (args.at(i) == "--filter" && i + 1 < args.count())
+        {
+            filter = args.at(++i);
+        }
+        else
+        {
+            err << "Usage: jenson-bench [--min-time <ms>] [--filter <workload/api/operation>]\n";
+            return 1;
+        }
+    }
+
+    QJsonArray results;
+
+    for (const Workload &workload : workloads)
+    {
+        QObject *root = workload.build();
+
+        foreach (const Api &api, apis())
+        {
+            QByteArray data;
+            api.write(root, &data);
+
+            if (!api.read(data))
+            {
+                err << "Failed to read back " << workload.name << "/" << api.name << "\n";
+                return 1;
+            }
+
+            const std::function<void()> ops[] =
+            {
+                [&]() { QByteArray out; api.write(root, &out); },
+                [&]() { api.read(data); },
+                [&]() { QByteArray out; api.write(root, &out); api.read(out); }
+            };
+            const char *opNames[] = { "serialize", "deserialize", "roundtrip" };
+
+            for (int i = 0; i < 3; i++)
+            {
+                const QString name = QString("%1/%2/%3").arg(workload.name, api.name, opNames[i]);
+                if (!name.contains(filter))
+                    continue;
+
+                err << name << "\n";
+                err.flush();
+                Measurement m = measure(ops[i], minTimeMs);
+                results.append(result(workload.name, api.name, opNames[i], m, data.size()));
+            }
+        }
+
+        delete root;
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    }
+
+    QJsonObject report;
+    report.insert("benchmark", QString("jenson-bench"));
+    report.insert("qtVersion", QString(qVersion()));
+    report.insert("minTimeMs", double(minTimeMs));
+    report.insert("allocations", QString("operator new calls"));
+    report.insert("results", results);
+
+    QTextStream(stdout) << QJsonDocument(report).toJson(QJsonDocument::Indented);
+    return 0;
+}
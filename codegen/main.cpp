@@ -0,0 +1,292 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+//
+// jenson-gen, generates typed field lists for the SERIALIZABLE classes of a header:
+//
+//     jenson-gen <header> -o <output.cpp>
+//
+// Every JENSON_PROPERTY_GETSET(_NOTIFY) member of a supported type (bool, int, float, double, qreal, QString and
+// pointers to the SERIALIZABLE classes of the header) becomes a jenson::makeField() entry, registered with
+// JenSON::registerGeneratedFields(). Classes with JENSON_FIELDS (their own or inherited) are skipped.
+// The header is scanned textually, like moc it does not expand other macros.
+//
+
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QMap>
+#include <QRegularExpression>
+#include <QSet>
+#include <QStringList>
+#include <QTextStream>
+
+namespace
+{
+    struct Member
+    {
+        QString type;
+        QString name;
+    };
+
+    struct Class
+    {
+        QString name;       // Qualified with the enclosing namespaces
+        QStringList bases;
+        QList<Member> members;
+        bool hasFields;
+    };
+
+    // Replaces comments by spaces, keeping string and character literals
+    QString stripComments(const QString &source)
+    {
+        QString retVal = source;
+        int i = 0;
+        while (i < retVal.size())
+        {
+            const QChar c = retVal.at(i);
+            if (c == '"' || c == '\'')
+            {
+                for (i++; i < retVal.size() && retVal.at(i) != c; i++)
+                    if (retVal.at(i) == '\\') i++;
+                i++;
+            }
+            else if (retVal.midRef(i, 2) == "//")
+            {
+                while (i < retVal.size() && retVal.at(i) != '\n')
+                    retVal[i++] = ' ';
+            }
+            else if (retVal.midRef(i, 2) == "/*")
+            {
+                int end = retVal.indexOf("*/", i + 2);
+                end = end < 0 ? retVal.size() : end + 2;
+                for (; i < end; i++)
+                    if (retVal.at(i) != '\n') retVal[i] = ' ';
+            }
+            else
+            {
+                i++;
+            }
+        }
+        return retVal;
+    }
+
+    // Returns the index after the brace closing the one at open, or -1
+    int closingBrace(const QString &source, int open)
+    {
+        int depth = 0;
+        for (int i = open; i < source.size(); i++)
+        {
+            if (source.at(i) == '{')
+                depth++;
+            else if (source.at(i) == '}' && --depth == 0)
+                return i + 1;
+        }
+        return -1;
+    }
+
+    QString normalizedType(QString type)
+    {
+        type.remove(QRegularExpression("\\s+"));
+        return type;
+    }
+
+    QList<Class> parseClasses(const QString &source)
+    {
+        // Namespace ranges, to qualify the class names
+        struct Scope { QString name; int begin; int end; };
+        QList<Scope> namespaces;
+        QRegularExpressionMatchIterator it = QRegularExpression("\\bnamespace\\s+(\\w+)\\s*\\{").globalMatch(source);
+        while (it.hasNext())
+        {
+            QRegularExpressionMatch m = it.next();
+            Scope scope = { m.captured(1), m.capturedStart(), closingBrace(source, m.capturedEnd() - 1) };
+            namespaces.append(scope);
+        }
+
+        QList<Class> retVal;
+        const QRegularExpression classRx("\\b(?:class|struct)\\s+(?:[A-Z_][A-Z0-9_]*\\s+)?(\\w+)\\s*(?::([^{};]*))?\\{");
+        const QRegularExpression memberRx("\\bJENSON_PROPERTY_GETSET(?:_NOTIFY)?\\s*\\(([^()]*)\\)");
+        const QRegularExpression fieldsRx("\\bJENSON_FIELDS\\s*\\(");
+
+        it = classRx.globalMatch(source);
+        while (it.hasNext())
+        {
+            QRegularExpressionMatch m = it.next();
+            const int end = closingBrace(source, m.capturedEnd() - 1);
+            if (end < 0)
+                continue;
+            const QString body = source.mid(m.capturedEnd(), end - m.capturedEnd());
+
+            Class cls;
+            QStringList scopes;
+            foreach (const Scope &scope, namespaces)
+                if (scope.begin < m.capturedStart() && m.capturedStart() < scope.end)
+                    scopes.append(scope.name);
+            scopes.append(m.captured(1));
+            cls.name = scopes.join("::");
+
+            foreach (QString base, m.captured(2).split(',', QString::SkipEmptyParts))
+            {
+                base.remove(QRegularExpression("<.*>"));
+                base.remove(QRegularExpression("\\b(public|protected|private|virtual)\\b"));
+                base = base.trimmed();
+                if (!base.isEmpty())
+                    cls.bases.append(base);
+            }
+
+            QRegularExpressionMatchIterator members = memberRx.globalMatch(body);
+            while (members.hasNext())
+            {
+                const QString args = members.next().captured(1);
+                const int comma = args.lastIndexOf(',');
+                if (comma < 0)
+                    continue;
+                Member member = { normalizedType(args.left(comma)), args.mid(comma + 1).trimmed() };
+                cls.members.append(member);
+            }
+
+            cls.hasFields = fieldsRx.match(body).hasMatch();
+            retVal.append(cls);
+        }
+        return retVal;
+    }
+
+    QStringList registeredClasses(const QString &source, const QString &macro)
+    {
+        QStringList retVal;
+        QRegularExpressionMatchIterator it = QRegularExpression("\\b" + macro + "\\s*\\(\\s*([\\w:]+)\\s*,").globalMatch(source);
+        while (it.hasNext())
+            retVal.append(it.next().captured(1));
+        return retVal;
+    }
+
+    // Finds a class by its (possibly less qualified) name
+    const Class* findClass(const QList<Class> &classes, const QString &name)
+    {
+        foreach (const Class &cls, classes)
+            if (cls.name == name || cls.name.endsWith("::" + name))
+                return &cls;
+        return nullptr;
+    }
+
+    bool isSupported(const QString &type, const QSet<QString> &objectClasses)
+    {
+        static const QSet<QString> scalars = QSet<QString>() << "bool" << "int" << "float" << "double" << "qreal" << "QString";
+        if (scalars.contains(type))
+            return true;
+        return type.endsWith('*') && objectClasses.contains(type.left(type.size() - 1));
+    }
+
+    QString generate(const QString &header, const QString &source)
+    {
+        const QList<Class> classes = parseClasses(source);
+        const QStringList serializable = registeredClasses(source, "SERIALIZABLE");
+        const QSet<QString> objectClasses = (serializable + registeredClasses(source, "CUSTOMSERIALIZABLE")).toSet();
+
+        QString retVal;
+        QTextStream out(&retVal);
+        out << "// Generated by jenson-gen from " << QFileInfo(header).fileName() << ", do not edit\n\n";
+        out << "#include \"" << QFileInfo(header).absoluteFilePath() << "\"\n";
+
+        QStringList registrations;
+        foreach (const QString &name, serializable)
+        {
+            // Own members first, then the ones of the base classes in this header
+            QList<Member> members;
+            QSet<QString> names;
+            bool hasFields = false;
+            for (const Class *cls = findClass(classes, name); cls; cls = cls->bases.isEmpty() ? nullptr : findClass(classes, cls->bases.first()))
+            {
+                hasFields |= cls->hasFields;
+                foreach (const Member &member, cls->members)
+                {
+                    if (!names.contains(member.name) && isSupported(member.type, objectClasses))
+                        members.append(member);
+                    names.insert(member.name);
+                }
+            }
+            if (hasFields || members.isEmpty())
+                continue;
+
+            QString id = name;
+            id.replace("::", "_");
+            if (registrations.isEmpty())
+                out << "\nnamespace\n{\n";
+            out << "    // " << name << "\n";
+            out << "    const jenson::IField *const " << id << "_fields[] = {\n";
+            foreach (const Member &member, members)
+                out << "        jenson::makeField(\"" << member.name << "\", &" << name << "::" << member.name
+                    << ", &" << name << "::set" << member.name << "),\n";
+            out << "    };\n";
+            out << "    const jenson::FieldList " << id << "_fieldList(" << id << "_fields, " << members.count() << ");\n\n";
+            registrations.append("jenson::JenSON::registerGeneratedFields(&" + name + "::staticMetaObject, &" + id + "_fieldList);");
+        }
+
+        if (!registrations.isEmpty())
+        {
+            out << "    struct RegisterGeneratedFields\n    {\n        RegisterGeneratedFields()\n        {\n";
+            foreach (const QString &registration, registrations)
+                out << "            " << registration << "\n";
+            out << "        }\n    } registerGeneratedFields;\n}\n";
+        }
+
+        out.flush();
+        return retVal;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QTextStream err(stderr);
+    QString header, output;
+    for (int i = 1; i < argc; i++)
+    {
+        const QString arg = QString::fromLocal8Bit(argv[i]);
+        if (arg == "-o" && i + 1 < argc)
+            output = QString::fromLocal8Bit(argv[++i]);
+        else
+            header = arg;
+    }
+
+    if (header.isEmpty() || output.isEmpty())
+    {
+        err << "Usage: jenson-gen <header> -o <output.cpp>\n";
+        return 2;
+    }
+
+    QFile in(header);
+    if (!in.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        err << "jenson-gen: cannot read " << header << ": " << in.errorString() << "\n";
+        return 1;
+    }
+    const QString generated = generate(header, stripComments(QString::fromUtf8(in.readAll())));
+
+    QFile out(output);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(generated.toUtf8()) < 0)
+    {
+        err << "jenson-gen: cannot write " << output << ": " << out.errorString() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -21,7 +21,11 @@
 ****************************************************************************/
 
 #include "jenson.h"
+#include "jenson_p.h"
+#include "jenson_format.h"
+#include "jenson_number.h"
 
+#include <cmath>
 #include <memory>
 #include <QStringList>
 #include <QJsonArray>
@@ -33,18 +37,12 @@ using namespace jenson;
 // Private methods declared here to keep header file clean
 //
 
-static bool findClass(const QJsonObject *jsonObj, QString *className, QString *errorMsg)
+static const ClassPlan* findClass(const QJsonObject *jsonObj, QString *errorMsg)
 {
-    int keyCount = jsonObj->keys().count();
+    int keyCount = jsonObj->count();
     if (keyCount == 1)
     {
-        QString type = JenSON::toClassName(jsonObj->keys().first());
-
-        if (JenSON::isRegistered(&type, errorMsg))
-        {
-            *className = type;
-            return true;
-        }
+        return resolveSerialName(jsonObj->begin().key(), errorMsg);
     }
     else if (errorMsg)
     {
@@ -54,14 +52,16 @@ static bool findClass(const QJsonObject *jsonObj, QString *className, QString *e
             errorMsg->append("\n JsonObj contains multiple keys");
     }
 
-    return false;
+    return nullptr;
 }
 
+static sptr<QObject> deserializeObject(const QJsonObject *jsonObj, const ClassPlan *plan, QString *errorMsg);
+static bool deserializeObjectInto(QObject *target, const QJsonObject *jsonObj, const ClassPlan *plan, bool partial, QString *errorMsg);
+
 static QJsonValue serialize(const QVariant var, bool *ok)
 {
     QJsonValue v;
     QObject *nestedObj = nullptr;
-    QJsonObject nestedJSON;
     QList<QVariant> varList;
     QJsonArray jsArray;
 
@@ -76,8 +76,7 @@ static QJsonValue serialize(const QVariant var, bool *ok)
         if (nestedObj)
         {
             *ok = true;
-            nestedJSON = JenSON::serialize(nestedObj);
-            v = nestedJSON.value(nestedJSON.keys().first());
+            v = serializeObject(nestedObj, ClassPlan::get(nestedObj->metaObject()));
         }
         break;
 
@@ -99,7 +98,7 @@ static QJsonValue serialize(const QVariant var, bool *ok)
 
             QObject *qObj = qvariant_cast<QObject*>(lvar);
             if (qObj)
-                listItem.insert(JenSON::toSerialName(qObj->metaObject()->className()), serialize(lvar, ok));
+                listItem.insert(ClassPlan::get(qObj->metaObject())->serialName, serialize(lvar, ok));
             else
                 listItem.insert(JenSON::toSerialName(lvar.typeName()), serialize(lvar, ok));
 
@@ -131,233 +130,872 @@ static QJsonValue serialize(const QVariant var, bool *ok)
     return v;
 }
 
+QObject* jenson::nestedObject(const QObject *qObj, const PropertyPlan &prop)
+{
+    if (prop.field)
+        return prop.field->object(qObj);
+    return qvariant_cast<QObject*>(prop.property.read(qObj));
+}
 
-//
-// serialization static class methods
-//
+// Json number of an array element, floats become the shortest decimal that reads back as the float
+static double toJsonNumber(double value) { return value; }
+static double toJsonNumber(int value) { return value; }
+static double toJsonNumber(float value)
+{
+    double json = value;
+    if (number::isFinite(value))
+    {
+        char buf[number::BufferSize];
+        number::parse(buf, number::formatShortest(buf, value), &json);
+    }
+    return json;
+}
 
-QJsonObject JenSON::serialize(const QObject *qObj)
+template <typename T>
+static QJsonArray toJsonArray(const QVector<T> &values)
 {
-    QJsonObject retVal; // return value
-    QJsonValue value;
+    QJsonArray array;
+    foreach (T value, values)
+        array.append(toJsonNumber(value));
+    return array;
+}
 
-    QString className = qObj->metaObject()->className();
-    QString serialName = toSerialName(className);
+template <typename T>
+static bool fromJsonArray(const QJsonValue &value, QVariant *var)
+{
+    if (!value.isArray())
+        return false;
 
-    if (serializerMap().contains(className))
+    const QJsonArray array = value.toArray();
+    QVector<T> values(array.count());
+    for (int i = 0; i < values.count(); i++)
     {
-        value = serializerMap()[className]->serialize(qObj);
+        const QJsonValue item = array.at(i);
+        if (!item.isDouble() || !toArrayElement(item.toDouble(), &values[i]))
+            return false;
     }
-    else
+
+    var->setValue(values);
+    return true;
+}
+
+QJsonValue jenson::arrayToJson(const QVariant &var, ArrayType array)
+{
+    switch (array)
+    {
+    case DoubleArray:
+        return toJsonArray(var.value<QVector<double>>());
+    case FloatArray:
+        return toJsonArray(var.value<QVector<float>>());
+    case IntArray:
+        return toJsonArray(var.value<QVector<int>>());
+    default:
+        return QJsonValue(QJsonValue::Undefined);
+    }
+}
+
+bool jenson::arrayFromJson(const QJsonValue &value, ArrayType array, QVariant *var)
+{
+    switch (array)
+    {
+    case DoubleArray:
+        return fromJsonArray<double>(value, var);
+    case FloatArray:
+        return fromJsonArray<float>(value, var);
+    case IntArray:
+        return fromJsonArray<int>(value, var);
+    default:
+        return false;
+    }
+}
+
+bool jenson::writesColumns(const PropertyPlan &prop, const ClassPlan *plan, const QVariant &container)
+{
+    if (!prop.columnar || plan->serializer)
+        return false;
+
+    // Null elements have no columnar representation
+    const int count = prop.container->count(container);
+    for (int i = 0; i < count; i++)
+        if (!prop.container->at(container, i))
+            return false;
+    return true;
+}
+
+// Elements of a typed container property, written without serial name wrapper as rows or columns
+static QJsonValue containerToJson(const QVariant &var, const PropertyPlan &prop)
+{
+    const ClassPlan *plan = ClassPlan::get(prop.nestedMeta);
+    const int count = prop.container->count(var);
+
+    if (writesColumns(prop, plan, var))
     {
-        QJsonObject propObj; // QProperties container
+        JENSON_STATS_CLASS(plan->metaObject);
+        Timing timing(plan->metaObject, &ClassStats::serialize);
 
-        // The first propetry objectName is skipped
-        for (int i = 1; i < qObj->metaObject()->propertyCount(); i++)
+        QJsonObject columns;
+        foreach (const PropertyPlan &column, plan->readable)
         {
-            QMetaProperty mp = qObj->metaObject()->property(i);
+            QJsonArray values;
+            for (int i = 0; i < count; i++)
+            {
+                QJsonValue v;
+                values.append(serializeProperty(prop.container->at(var, i), column, &v) ? v : QJsonValue());
+            }
+            columns.insert(column.key, values);
+        }
 
-            if (!mp.isReadable())
-                continue;
+        QJsonObject retVal;
+        retVal.insert("class", plan->serialName);
+        retVal.insert("count", count);
+        retVal.insert("columns", columns);
+        return retVal;
+    }
+
+    QJsonArray array;
+    for (int i = 0; i < count; i++)
+    {
+        QObject *element = prop.container->at(var, i);
+        array.append(element ? serializeObject(element, plan) : QJsonValue());
+    }
+    return array;
+}
 
-            QVariant var = mp.read(qObj);
+// Reads the columnar layout of a typed container, every column holds count values
+static bool columnsFromJson(const QJsonObject &json, const ClassPlan *plan, std::vector<sptr<QObject>> *elements, QString *errorMsg)
+{
+    JENSON_STATS_CLASS(plan->metaObject);
+    Timing timing(plan->metaObject, &ClassStats::deserialize);
 
-            bool ok = false;
+    const QJsonObject columns = json.value("columns").toObject();
+    const int count = json.value("count").toInt(-1);
+    bool valid = !plan->serializer && count >= 0 && json.value("class").toString() == plan->serialName;
+    for (QJsonObject::const_iterator it = columns.constBegin(); valid && it != columns.constEnd(); ++it)
+        valid = it.value().isArray() && it.value().toArray().count() == count;
 
-            QJsonValue v = ::serialize(var, &ok);
+    if (!valid)
+    {
+        if (errorMsg) errorMsg->append("\n Invalid columns of class " + plan->serialName);
+        return false;
+    }
 
-            if (!ok)
-                continue;
+    for (int i = 0; i < count; i++)
+        elements->push_back(newInstance(plan));
 
-            propObj.insert(mp.name(), v);
+    foreach (const PropertyPlan &prop, plan->writable)
+    {
+        const QJsonArray column = columns.value(prop.key).toArray();
+        for (int i = 0; i < count; i++)
+        {
+            // Nulls are missing values, like the absent keys of a row
+            QJsonValue value = column.isEmpty() || column.at(i).isNull() ? QJsonValue(QJsonValue::Undefined) : column.at(i);
+            if (!deserializeProperty(elements->at(i).get(), prop, value, errorMsg))
+                return false;
         }
+    }
+
+    for (const sptr<QObject> &element : *elements)
+        finishObject(element.get(), plan);
+    return true;
+}
 
-        value = propObj;
+// Reads the elements of a typed container property (rows or columns), parented to target. Returns false
+// if value is not a container or an element failed, the elements are deleted unless the property is written.
+static bool containerFromJson(QObject *target, const QJsonValue &value, const PropertyPlan &prop, QString *errorMsg)
+{
+    const ClassPlan *plan = ClassPlan::get(prop.nestedMeta);
+    std::vector<sptr<QObject>> owned;
+    QVector<QObject*> elements;
+
+    if (value.isObject())
+    {
+        if (!columnsFromJson(value.toObject(), plan, &owned, errorMsg))
+            return false;
+        for (const sptr<QObject> &element : owned)
+            elements.append(element.get());
     }
+    else if (value.isArray())
+    {
+        const QJsonArray array = value.toArray();
+        const int count = array.count();
+        QVector<QString> errors(count);
+        QString *errorData = errors.data();
 
-    retVal.insert(serialName, value);
+        // Null items stay nullptr
+        auto element = [&](int i) -> sptr<QObject>
+        {
+            const QJsonValue item = array.at(i);
+            if (item.isNull())
+                return nullptr;
 
-    return retVal;
+            if (plan->serializer)
+            {
+                JENSON_STATS_CLASS(plan->metaObject);
+                Timing timing(plan->metaObject, &ClassStats::customDeserialize);
+                JENSON_STATS_COUNT(objects);
+                return plan->serializer->deserialize(&item, &errorData[i]);
+            }
+
+            QJsonObject elementJSON = item.toObject();
+            return deserializeObject(&elementJSON, plan, &errorData[i]);
+        };
+
+        std::vector<sptr<QObject>> built;
+        if (runsParallel(count))
+        {
+            parallelBuild(count, element, &built);
+        }
+        else
+        {
+            // Stops at the first failed element
+            for (int i = 0; i < count; i++)
+            {
+                built.push_back(element(i));
+                if (!built.back() && !array.at(i).isNull())
+                    break;
+            }
+        }
+
+        owned.reserve(count);
+        elements.reserve(count);
+        for (int i = 0; i < int(built.size()); i++)
+        {
+            if (!built[i] && !array.at(i).isNull())
+            {
+                if (errorMsg)
+                    errorMsg->append(errors.at(i));
+                return false;
+            }
+
+            elements.append(built[i].get());
+            if (built[i])
+                owned.push_back(std::move(built[i]));
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    for (const sptr<QObject> &element : owned)
+        element->setParent(target);
+
+    JENSON_STATS_COUNT(variants);
+    if (!prop.property.write(target, prop.container->fromObjects(elements.constData(), elements.count())))
+        return false;
+
+    for (sptr<QObject> &element : owned)
+        element.release();
+    return true;
 }
 
-sptr<QObject> JenSON::deserializeToObject(const QJsonObject *jsonObj)
+QJsonValue jenson::lazyJson(const QObject *qObj, const PropertyPlan &prop)
 {
-    QString errorMsg;
-    sptr<QObject> retVal = deserializeToObject(jsonObj, &errorMsg);
+    QJsonValue json(QJsonValue::Undefined);
+    JENSON_STATS_COUNT(jsonValues);
+    if (prop.lazyGet.isValid())
+        prop.lazyGet.invoke(const_cast<QObject*>(qObj), Qt::DirectConnection, Q_RETURN_ARG(QJsonValue, json));
+    return json;
+}
 
-    if (!retVal)
-        throw SerializationException(errorMsg);
+// JENSON_PRECISION rounding of a number or number array
+static QJsonValue roundNumbers(const QJsonValue &value, int precision)
+{
+    if (value.isDouble())
+        return number::round(value.toDouble(), precision);
+    if (!value.isArray())
+        return value;
+
+    QJsonArray rounded;
+    foreach (const QJsonValue &v, value.toArray())
+        rounded.append(v.isDouble() ? QJsonValue(number::round(v.toDouble(), precision)) : v);
+    return rounded;
+}
 
-    return retVal;
+bool jenson::serializeProperty(const QObject *qObj, const PropertyPlan &prop, QJsonValue *value)
+{
+    // Unmaterialized lazy properties are written as read
+    if (prop.lazyGet.isValid())
+    {
+        QJsonValue json = lazyJson(qObj, prop);
+        if (!json.isUndefined())
+        {
+            *value = json;
+            return true;
+        }
+    }
+
+    // Numeric arrays are plain number arrays
+    if (prop.array != NoArray)
+    {
+        JENSON_STATS_COUNT(variants);
+        JENSON_STATS_COUNT(jsonValues);
+        *value = arrayToJson(prop.property.read(qObj), prop.array);
+        if (prop.precision >= 0)
+            *value = roundNumbers(*value, prop.precision);
+        return true;
+    }
+
+    // Typed containers, the elements are not boxed
+    if (prop.container)
+    {
+        JENSON_STATS_COUNT(variants);
+        JENSON_STATS_COUNT(jsonValues);
+        *value = containerToJson(prop.property.read(qObj), prop);
+        return true;
+    }
+
+    // Typed fields skip the QVariant boxing
+    if (prop.field)
+    {
+        if (prop.field->kind() != IField::Object)
+        {
+            JENSON_STATS_COUNT(jsonValues);
+            *value = prop.field->toJson(qObj);
+            if (prop.precision >= 0)
+                *value = roundNumbers(*value, prop.precision);
+            return true;
+        }
+
+        QObject *nestedObj = prop.field->object(qObj);
+        if (!nestedObj)
+            return false;
+        *value = serializeObject(nestedObj, ClassPlan::get(nestedObj->metaObject()));
+        return true;
+    }
+
+    JENSON_STATS_COUNT(variants);
+    JENSON_STATS_COUNT(jsonValues);
+    QVariant var = prop.property.read(qObj);
+
+    bool ok = false;
+
+    *value = ::serialize(var, &ok);
+    if (ok && prop.precision >= 0)
+        *value = roundNumbers(*value, prop.precision);
+
+    return ok;
 }
 
-sptr<QObject> JenSON::deserializeClass(const QJsonObject *jsonObj, QString className)
+QJsonValue jenson::serializeObject(const QObject *qObj, const ClassPlan *plan)
 {
-    QString errorMsg;
-    sptr<QObject> retVal = deserializeClass(jsonObj, className, &errorMsg);
+    JENSON_STATS_CLASS(plan->metaObject);
+    Timing timing(plan->metaObject, plan->serializer ? &ClassStats::customSerialize : &ClassStats::serialize);
+
+    if (plan->serializer)
+    {
+        JENSON_STATS_COUNT(jsonValues);
+        return plan->serializer->serialize(qObj);
+    }
 
+    QJsonObject propObj; // QProperties container
+
+    foreach (const PropertyPlan &prop, plan->readable)
+    {
+        QJsonValue v;
+
+        if (!serializeProperty(qObj, prop, &v))
+            continue;
+
+        propObj.insert(prop.key, v);
+    }
+
+    return propObj;
+}
+
+sptr<QObject> jenson::newInstance(const ClassPlan *plan)
+{
+    sptr<QObject> retVal(plan->metaObject->newInstance());
     if (!retVal)
-        throw SerializationException(errorMsg);
+    {
+        QString msg = "serialization::deserialize failed for " + plan->className +
+                ": the default ctor is not invokable. Add the Q_INVOKABLE macro.";
+        throw SerializationException(msg);
+    }
 
+    CreatedObjects::record(retVal.get());
+    JENSON_STATS_COUNT(objects);
     return retVal;
 }
 
-sptr<QObject> JenSON::deserializeToObject(const QJsonObject *jsonObj, QString *errorMsg)
+bool jenson::handleWriteFailure(QObject *target, const PropertyPlan &prop, const QString &className, QString *errorMsg)
 {
-    QString className;
+    if (prop.property.isResettable())
+    {
+        prop.property.reset(target);
+        return true;
+    }
 
-    if (!findClass(jsonObj, &className, errorMsg))
-        return nullptr;
+    if (errorMsg)
+    {
+        errorMsg->append("\n Failed to deserialize ");
+        if (!className.isEmpty()) errorMsg->append(className + "::");
+        errorMsg->append(prop.key);
+        errorMsg->append(" of type: ");
+        errorMsg->append(prop.property.typeName());
+    }
+    return false;
+}
 
-    // Extract the class data
-    QJsonValue classValue = jsonObj->value(toSerialName(className));
+// QVariant supported list items are wrapped in their type name, returns false for objects
+static bool listValueFromJson(const QJsonObject &itemJSON, QVariant *var)
+{
+    QString firstKey = itemJSON.keys().first();
+    int typeId = QVariant::nameToType(firstKey.toStdString().c_str());
+    if (typeId == QVariant::Invalid || typeId == QVariant::UserType)
+        return false;
 
-    // Use custom deserializer if available
-    if (serializerMap().contains(className))
-        return serializerMap()[className]->deserialize(&classValue, errorMsg);
+    QJsonValue val = itemJSON.value(firstKey);
+    if (val.isNull())
+        return false;
 
-    QJsonObject classDataObject = classValue.toObject();
-    return deserializeClass(&classDataObject, className, errorMsg);
+    *var = val.toVariant();
+    return true;
 }
 
-sptr<QObject> JenSON::deserializeClass(const QJsonObject *jsonObj, QString className, QString *errorMsg)
+// Parents nestedObj to target and writes it to prop
+static bool writeNestedObject(QObject *target, const PropertyPlan &prop, QObject *nestedObj)
 {
-    className = className.replace('*', ""); // Properties can be pointer types
+    nestedObj->setParent(target);
+    if (prop.field)
+        return prop.field->setObject(target, nestedObj);
 
-    if (!isRegistered(&className, errorMsg))
-        return nullptr;
+    QVariant var;
+    var.setValue(nestedObj);
+    return prop.property.write(target, var);
+}
 
-    const QObject *obj = typeMap()[className];
-    sptr<QObject> retVal(obj->metaObject()->newInstance());
-    if (!retVal)
+bool jenson::deserializeProperty(QObject *target, const PropertyPlan &prop, const QJsonValue &value, QString *errorMsg)
+{
+    // init local variables
+    QString className = prop.className;
+    QObject *nestedObj = nullptr;
+    QJsonObject nestedJSON;
+    QJsonArray jsonArray;
+    QVariant var;
+    QList<QVariant> varList;
+    QStringList stringList;
+    bool writeSucceeded = false;
+
+    // Lazy properties keep the Json until first use
+    if (prop.lazySet.isValid())
+        return prop.lazySet.invoke(target, Qt::DirectConnection, Q_ARG(QJsonValue, value));
+
+    // Numeric arrays, other values fail like any unconvertible value
+    if (prop.array != NoArray)
     {
-        QString msg = "serialization::deserialize failed for " + className +
-                ": the default ctor is not invokable. Add the Q_INVOKABLE macro.";
-        throw SerializationException(msg);
+        JENSON_STATS_COUNT(variants);
+        if (arrayFromJson(value, prop.array, &var))
+            writeSucceeded = prop.property.write(target, var);
+        if (!writeSucceeded)
+            return handleWriteFailure(target, prop, className, errorMsg);
+        return true;
     }
 
-    // Loop over and write class properties
-    // The first propetry objectName is skipped
-    for (int i = 1; i < retVal->metaObject()->propertyCount(); i++)
+    if (prop.container)
     {
-        QMetaProperty mp = retVal->metaObject()->property(i);
-        QString propName = mp.name();
-        className = mp.typeName();
-        className = className.replace('*', "");
+        if (!containerFromJson(target, value, prop, errorMsg))
+            return handleWriteFailure(target, prop, className, errorMsg);
+        return true;
+    }
 
-        if (mp.isWritable())
+    // Typed fields write values of the matching Json type directly,
+    // other values use the QVariant conversions below
+    if (prop.field && prop.field->kind() != IField::Object && prop.field->fromJson(target, value))
+        return true;
+
+    JENSON_STATS_COUNT(variants);
+
+    switch (prop.type)
+    {
+    case QVariant::UserType:
+        // Use custom deserializer if available
+        if (prop.serializer)
         {
-            // init local variables
-            QObject *nestedObj = nullptr;
-            QJsonObject nestedJSON;
-            QJsonValue nestedJsonValue;
-            QJsonArray jsonArray;
-            QVariant var;
-            QList<QVariant> varList;
-            QStringList stringList;
-            bool writeSucceeded = false;
-
-            switch (mp.type())
-            {
-            case QVariant::UserType:
-                nestedJsonValue = jsonObj->value(propName);
-                nestedJSON = nestedJsonValue.toObject();
+            JENSON_STATS_CLASS(prop.nestedMeta);
+            Timing timing(prop.nestedMeta, &ClassStats::customDeserialize);
+            JENSON_STATS_COUNT(objects);
+            nestedObj = prop.serializer->deserialize(&value, errorMsg).release();
+            CreatedObjects::record(nestedObj); // Not created by newInstance, move it with the graph too
+        }
+        else
+        {
+            nestedJSON = value.toObject();
 
-                // Use custom deserializer if available
-                if (serializerMap().contains(className))
-                {
-                    nestedObj = serializerMap()[className]->deserialize(&nestedJsonValue, errorMsg).release();
-                }
-                else
-                {
-                    // get className from nestedJSON if specified
-                    findClass(&nestedJSON, &className, nullptr);
+            // get className from nestedJSON if specified
+            const ClassPlan *nestedPlan = findClass(&nestedJSON, nullptr);
+            if (!nestedPlan && prop.nestedMeta)
+                nestedPlan = ClassPlan::get(prop.nestedMeta);
 
-                    nestedObj = deserializeClass(&nestedJSON, className, errorMsg).release();
-                }
+            if (nestedPlan)
+                nestedObj = deserializeObject(&nestedJSON, nestedPlan, errorMsg).release();
+            else
+                JenSON::isRegistered(&className, errorMsg);
+        }
 
-                if (nestedObj)
-                {
-                    nestedObj->setParent(retVal.get());
-                    var.setValue(nestedObj);
-                    writeSucceeded = mp.write(retVal.get(), var);
-                }
-                break;
+        if (nestedObj)
+            writeSucceeded = writeNestedObject(target, prop, nestedObj);
+        break;
+
+    case QVariant::StringList:
+        jsonArray = value.toArray();
 
-            case QVariant::StringList:
-                jsonArray = jsonObj->value(propName).toArray();
+        foreach (QJsonValue item, jsonArray)
+            stringList.append(item.toString());
 
-                foreach (QJsonValue item, jsonArray)
-                    stringList.append(item.toString());
+        writeSucceeded = prop.property.write(target, stringList);
+        break;
 
-                writeSucceeded = mp.write(retVal.get(), stringList);
-                break;
+    case QVariant::List:
+        jsonArray = value.toArray();
+        if (runsParallel(jsonArray.count()))
+        {
+            QVector<QVariant> items(jsonArray.count());
+            QVariant *itemData = items.data();
+            std::vector<sptr<QObject>> objects;
+
+            parallelBuild(jsonArray.count(), [&](int i) -> sptr<QObject>
+            {
+                QJsonObject itemJSON = jsonArray.at(i).toObject();
+                if (listValueFromJson(itemJSON, &itemData[i]))
+                    return nullptr;
+                return JenSON::deserializeToObject(&itemJSON);
+            }, &objects);
 
-            case QVariant::List:
-                jsonArray = jsonObj->value(propName).toArray();
-                foreach (QJsonValue item, jsonArray)
+            for (int i = 0; i < jsonArray.count(); i++)
+            {
+                if (objects[i])
+                    itemData[i].setValue(objects[i].release());
+                varList.append(itemData[i]);
+            }
+        }
+        else
+        {
+            foreach (QJsonValue item, jsonArray)
+            {
+                QVariant vObj;
+                nestedJSON = item.toObject();
+
+                // deserialize QVariant supported type
+                if (listValueFromJson(nestedJSON, &vObj))
                 {
-                    QVariant vObj;
-                    nestedJSON = item.toObject();
-
-                    // deserialize QVariant supported type
-                    QString firstKey = nestedJSON.keys().first();
-                    int typeId = QVariant::nameToType(firstKey.toStdString().c_str());
-                    if (typeId != QVariant::Invalid && typeId != QVariant::UserType)
-                    {
-                        QJsonValue val = nestedJSON.value(firstKey);
-                        if (!val.isNull())
-                        {
-                            varList.append(val.toVariant());
-                            continue;
-                        }
-                    }
-
-                    // deserialize custom type
-                    vObj.setValue(deserializeToObject(&nestedJSON).release());
                     varList.append(vObj);
+                    continue;
                 }
-                writeSucceeded = mp.write(retVal.get(), varList);
-                break;
 
-            default:
-                writeSucceeded = mp.write(retVal.get(), jsonObj->value(propName).toVariant());
-                break;
+                // deserialize custom type
+                vObj.setValue(JenSON::deserializeToObject(&nestedJSON).release());
+                varList.append(vObj);
             }
+        }
+        writeSucceeded = prop.property.write(target, varList);
+        break;
+
+    default:
+        writeSucceeded = prop.property.write(target, value.toVariant());
+        break;
+    }
+
+    if (!writeSucceeded)
+        return handleWriteFailure(target, prop, className, errorMsg);
 
-            if (!writeSucceeded)
+    return true;
+}
+
+void jenson::finishObject(QObject *obj, const ClassPlan *plan)
+{
+    // Try to invoke the onDeserialized() method before returning the object
+    if (plan->onDeserialized.isValid())
+        plan->onDeserialized.invoke(obj, Qt::DirectConnection);
+}
+
+// Returns the plan of the nested object in value, like deserializeProperty would create it
+static const ClassPlan* nestedPlan(const PropertyPlan &prop, const QJsonObject *nestedJSON)
+{
+    const ClassPlan *plan = findClass(nestedJSON, nullptr);
+    if (!plan && prop.nestedMeta)
+        plan = ClassPlan::get(prop.nestedMeta);
+    return plan;
+}
+
+// Counts the Json values in value, stops counting at limit
+static int countValues(const QJsonValue &value, int limit)
+{
+    int count = 1;
+
+    if (value.isObject())
+    {
+        const QJsonObject obj = value.toObject();
+        for (QJsonObject::const_iterator it = obj.constBegin(); it != obj.constEnd() && count < limit; ++it)
+            count += countValues(it.value(), limit - count);
+    }
+    else if (value.isArray())
+    {
+        const QJsonArray array = value.toArray();
+        for (QJsonArray::const_iterator it = array.constBegin(); it != array.constEnd() && count < limit; ++it)
+            count += countValues(*it, limit - count);
+    }
+
+    return count;
+}
+
+// Indexes of the writable properties with a nested object large enough to build in parallel,
+// empty unless at least two siblings qualify
+static QVector<int> parallelNestedProperties(const QJsonObject *jsonObj, const ClassPlan *plan)
+{
+    QVector<int> retVal;
+    const int minValues = parallelMinValues.loadAcquire();
+    if (minValues <= 0)
+        return retVal;
+
+    for (int i = 0; i < plan->writable.count(); i++)
+    {
+        // The properties deserializeProperty builds with deserializeObject
+        const PropertyPlan &prop = plan->writable.at(i);
+        if (prop.type != QVariant::UserType || prop.serializer || prop.container || prop.array != NoArray ||
+                prop.lazySet.isValid() || (prop.field && prop.field->kind() != IField::Object))
+            continue;
+
+        const QJsonValue value = jsonObj->value(prop.key);
+        QJsonObject nestedJSON = value.toObject();
+        if (value.isObject() && nestedPlan(prop, &nestedJSON) && countValues(value, minValues) >= minValues)
+            retVal.append(i);
+    }
+
+    if (retVal.count() < 2)
+        retVal.clear();
+    return retVal;
+}
+
+static sptr<QObject> deserializeObject(const QJsonObject *jsonObj, const ClassPlan *plan, QString *errorMsg)
+{
+    JENSON_STATS_CLASS(plan->metaObject);
+    Timing timing(plan->metaObject, &ClassStats::deserialize);
+
+    sptr<QObject> retVal = newInstance(plan);
+
+    // Large nested objects of sibling properties are built in parallel, then written in property order
+    const QVector<int> parallel = parallelNestedProperties(jsonObj, plan);
+    QVector<QString> nestedErrors(parallel.count());
+    std::vector<sptr<QObject>> nested;
+    if (!parallel.isEmpty())
+    {
+        QString *errorData = nestedErrors.data();
+        parallelBuild(parallel.count(), [&](int i)
+        {
+            const PropertyPlan &prop = plan->writable.at(parallel.at(i));
+            QJsonObject nestedJSON = jsonObj->value(prop.key).toObject();
+            return deserializeObject(&nestedJSON, nestedPlan(prop, &nestedJSON), &errorData[i]);
+        }, &nested);
+    }
+
+    // Loop over and write class properties
+    int next = 0;
+    for (int i = 0; i < plan->writable.count(); i++)
+    {
+        const PropertyPlan &prop = plan->writable.at(i);
+        JENSON_STATS_COUNT(jsonValues);
+
+        if (next < parallel.count() && parallel.at(next) == i)
+        {
+            if (errorMsg)
+                errorMsg->append(nestedErrors.at(next));
+            QObject *nestedObj = nested[next++].release();
+            if ((!nestedObj || !writeNestedObject(retVal.get(), prop, nestedObj)) &&
+                    !handleWriteFailure(retVal.get(), prop, prop.className, errorMsg))
+                return nullptr;
+            continue;
+        }
+
+        if (!deserializeProperty(retVal.get(), prop, jsonObj->value(prop.key), errorMsg))
+            return nullptr;
+    }
+
+    finishObject(retVal.get(), plan);
+
+    return retVal;
+}
+
+static bool deserializePropertyInto(QObject *target, const PropertyPlan &prop, const QJsonValue &value, bool partial, QString *errorMsg)
+{
+    // Reuse the current child if it is of the deserialized class,
+    // lazy properties are replaced unless merging a delta
+    if (prop.type == QVariant::UserType && !prop.serializer && !prop.container && (partial || !prop.lazySet.isValid()))
+    {
+        QJsonObject nestedJSON = value.toObject();
+
+        // Deltas wrap replaced children with their serial name, these are deserialized fresh
+        if (partial && prop.array == NoArray && !prop.lazySet.isValid() && !(prop.field && prop.field->kind() != IField::Object))
+        {
+            const ClassPlan *plan = findClass(&nestedJSON, nullptr);
+            if (plan && !plan->serializer)
             {
-                if (mp.isResettable())
-                {
-                    mp.reset(retVal.get());
-                }
-                else
-                {
-                    if (errorMsg)
-                    {
-                        errorMsg->append("\n Failed to deserialize ");
-                        if (!className.isEmpty()) errorMsg->append(className + "::");
-                        errorMsg->append(mp.name());
-                        errorMsg->append(" of type: ");
-                        errorMsg->append(mp.typeName());
-                    }
-                    return nullptr;
-                }
+                QJsonObject classDataObject = nestedJSON.begin().value().toObject();
+                sptr<QObject> nestedObj = deserializeObject(&classDataObject, plan, errorMsg);
+                if (!nestedObj)
+                    return false;
+                return writeNestedObject(target, prop, nestedObj.release()) ||
+                        handleWriteFailure(target, prop, prop.className, errorMsg);
             }
         }
 
+        QObject *current = nestedObject(target, prop);
+        if (current)
+        {
+            const ClassPlan *plan = nestedPlan(prop, &nestedJSON);
+            if (plan && !plan->serializer && current->metaObject() == plan->metaObject)
+                return deserializeObjectInto(current, &nestedJSON, plan, partial, errorMsg);
+        }
+    }
+
+    return deserializeProperty(target, prop, value, errorMsg);
+}
+
+// In partial mode (deltas) only the properties present in jsonObj are written
+static bool deserializeObjectInto(QObject *target, const QJsonObject *jsonObj, const ClassPlan *plan, bool partial, QString *errorMsg)
+{
+    JENSON_STATS_CLASS(plan->metaObject);
+    Timing timing(plan->metaObject, &ClassStats::deserialize);
+
+    foreach (const PropertyPlan &prop, plan->writable)
+    {
+        QJsonObject::const_iterator it = jsonObj->constFind(prop.key);
+        if (partial && it == jsonObj->constEnd())
+            continue;
+
+        JENSON_STATS_COUNT(jsonValues);
+        QJsonValue value = (it == jsonObj->constEnd()) ? QJsonValue(QJsonValue::Undefined) : it.value();
+        if (!deserializePropertyInto(target, prop, value, partial, errorMsg))
+            return false;
     }
 
-    // Try to invoke the onDeserialized() method before returning the object
-    int idx = obj->metaObject()->indexOfMethod("onDeserialized()");
-    if (idx >= 0) obj->metaObject()->method(idx).invoke(retVal.get(), Qt::DirectConnection);
+    finishObject(target, plan);
+
+    return true;
+}
+
+
+//
+// serialization static class methods
+//
+
+QJsonObject JenSON::serialize(const QObject *qObj)
+{
+    QJsonObject retVal; // return value
+    const ClassPlan *plan = ClassPlan::get(qObj->metaObject());
+
+    retVal.insert(plan->serialName, serializeObject(qObj, plan));
 
     return retVal;
 }
 
+sptr<QObject> JenSON::deserializeToObject(const QJsonObject *jsonObj)
+{
+    QString errorMsg;
+    sptr<QObject> retVal = deserializeToObject(jsonObj, &errorMsg);
+
+    if (!retVal)
+        throw SerializationException(errorMsg);
+
+    return retVal;
+}
+
+sptr<QObject> JenSON::deserializeClass(const QJsonObject *jsonObj, QString className)
+{
+    QString errorMsg;
+    sptr<QObject> retVal = deserializeClass(jsonObj, className, &errorMsg);
+
+    if (!retVal)
+        throw SerializationException(errorMsg);
+
+    return retVal;
+}
+
+sptr<QObject> JenSON::deserializeToObject(const QJsonObject *jsonObj, QString *errorMsg)
+{
+    const ClassPlan *plan = findClass(jsonObj, errorMsg);
+    if (!plan)
+        return nullptr;
+
+    // Extract the class data
+    QJsonValue classValue = jsonObj->value(plan->serialName);
+
+    // Use custom deserializer if available
+    if (plan->serializer)
+    {
+        JENSON_STATS_CLASS(plan->metaObject);
+        Timing timing(plan->metaObject, &ClassStats::customDeserialize);
+        JENSON_STATS_COUNT(objects);
+        return plan->serializer->deserialize(&classValue, errorMsg);
+    }
+
+    QJsonObject classDataObject = classValue.toObject();
+    return deserializeObject(&classDataObject, plan, errorMsg);
+}
+
+sptr<QObject> JenSON::deserializeClass(const QJsonObject *jsonObj, QString className, QString *errorMsg)
+{
+    if (className.contains('*'))
+        className.remove('*'); // Properties can be pointer types
+
+    const ClassPlan *plan = ClassPlan::get(className);
+    if (!plan)
+    {
+        isRegistered(&className, errorMsg); // Appends the error
+        return nullptr;
+    }
+
+    return deserializeObject(jsonObj, plan, errorMsg);
+}
+
+void JenSON::deserializeInto(QObject *target, const QJsonObject *jsonObj)
+{
+    QString errorMsg;
+    if (!deserializeInto(target, jsonObj, &errorMsg))
+        throw SerializationException(errorMsg);
+}
+
+static bool updateObject(QObject *target, const QJsonObject *jsonObj, bool partial, QString *errorMsg)
+{
+    const ClassPlan *plan = ClassPlan::get(target->metaObject());
+
+    if (plan->serializer)
+    {
+        if (errorMsg)
+            errorMsg->append("\n Cannot deserialize into " + plan->className + ": it uses a custom serializer");
+        return false;
+    }
+
+    // Unwrap the class data if the serial name is specified
+    if (jsonObj->count() == 1 && jsonObj->begin().key() == plan->serialName && jsonObj->begin().value().isObject())
+    {
+        QJsonObject classDataObject = jsonObj->begin().value().toObject();
+        return deserializeObjectInto(target, &classDataObject, plan, partial, errorMsg);
+    }
+
+    return deserializeObjectInto(target, jsonObj, plan, partial, errorMsg);
+}
+
+bool JenSON::deserializeInto(QObject *target, const QJsonObject *jsonObj, QString *errorMsg)
+{
+    return updateObject(target, jsonObj, false, errorMsg);
+}
+
+void JenSON::applyDelta(QObject *target, const QJsonObject *delta)
+{
+    QString errorMsg;
+    if (!applyDelta(target, delta, &errorMsg))
+        throw SerializationException(errorMsg);
+}
+
+bool JenSON::applyDelta(QObject *target, const QJsonObject *delta, QString *errorMsg)
+{
+    return updateObject(target, delta, true, errorMsg);
+}
+
 bool JenSON::isRegistered(QString *className, QString *errorMsg)
 {
-    if (!typeMap().contains(*className))
+    if (Registry::current()->handleOfClass(*className) < 0)
     {
         if (errorMsg)
             errorMsg->append("\n Class \"" + *className + "\" is not registered for deserialization");
@@ -369,16 +1007,17 @@ bool JenSON::isRegistered(QString *className, QString *errorMsg)
 
 QString JenSON::toSerialName(QString className)
 {
-    className = className.replace('*', "");
-    if (nameMap().left.find(className) == nameMap().left.end())
-        return className;
-    return nameMap().left.at(className);
+    if (className.contains('*'))
+        className.remove('*');
+    const TypeEntry *type = Registry::current()->entry(className);
+    return type ? type->serialName : className;
 }
 
 QString JenSON::toClassName(QString serialName)
 {
-    serialName = serialName.replace('*', "");
-    if (nameMap().right.find(serialName) == nameMap().right.end())
-        return serialName;
-    return nameMap().right.at(serialName);
+    if (serialName.contains('*'))
+        serialName.remove('*');
+    const Registry *reg = Registry::current();
+    int handle = reg->handleOfSerialName(serialName);
+    return handle < 0 ? serialName : reg->types.at(handle).className;
 }
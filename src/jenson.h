@@ -49,27 +49,75 @@
     Q_PROPERTY(TYPE MEMBERNAME READ MEMBERNAME WRITE set##MEMBERNAME) \
     JENSON_GETSET(TYPE, MEMBERNAME)
 
+// Convenience macro for POCO objects tracked by a jenson::ChangeTracker,
+// the setter emits MEMBERNAMEChanged() when the value changes
+#define JENSON_PROPERTY_GETSET_NOTIFY(TYPE, MEMBERNAME) \
+    Q_PROPERTY(TYPE MEMBERNAME READ MEMBERNAME WRITE set##MEMBERNAME NOTIFY MEMBERNAME##Changed) \
+    private: TYPE _##MEMBERNAME; \
+    public: \
+    TYPE MEMBERNAME() const { \
+        return _##MEMBERNAME; \
+    }; \
+    void set##MEMBERNAME(TYPE value) { \
+        if (_##MEMBERNAME == value) return; \
+        _##MEMBERNAME = value; \
+        emit MEMBERNAME##Changed(); \
+    } \
+    Q_SIGNAL void MEMBERNAME##Changed();
+
+// Writes the qreal (or QVector<double/float>) property MEMBERNAME rounded to DIGITS decimal places (at most 15)
+// instead of the shortest representation that reads back exactly
+#define JENSON_PRECISION(MEMBERNAME, DIGITS) \
+    Q_CLASSINFO("jenson.precision." #MEMBERNAME, #DIGITS)
+
+// Writes the QList<T*> or QVector<T*> property MEMBERNAME as columns, one array per property of T:
+// {"class": serialName, "count": n, "columns": {"x": [x0, x1, ...], ...}}.
+// Containers with null elements or of custom serialized classes are written as rows.
+#define JENSON_COLUMNAR(MEMBERNAME) \
+    Q_CLASSINFO("jenson.columnar." #MEMBERNAME, "true")
 
+
+#include <functional>
+#include <vector>
 #include <QObject>
+#include <QException>
+#include <QFuture>
+#include <QFutureInterface>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QMetaProperty>
 #include "boost/bimap.hpp"
 #include "qmemory.hpp"
 #include "jenson_global.hpp"
+#include "jenson_field.hpp"
+#include "jenson_container.hpp"
+#include "jenson_arena.h"
+#include "jenson_tracker.h"
+#include "jenson_lazy.h"
+#include "jenson_stats.h"
+#include "jenson_metrics.h"
+
+class QIODevice;
 
 #ifdef JENSON_QPTR
     template <typename T>
     using sptr = qunique_ptr<T>;
+    // Shared variant of sptr, results of the asynchronous methods (QFuture results are copied)
+    template <typename T>
+    using shptr = qshared_ptr<T>;
 #else
     template <typename T>
     using sptr = std::unique_ptr<T>;
+    template <typename T>
+    using shptr = std::shared_ptr<T>;
 #endif
 
 namespace jenson
 {
     typedef boost::bimap<QString, QString> nm_type;
 
-    class JENSONSHARED_EXPORT SerializationException : public std::exception
+    // A QException, so futures of the asynchronous methods can rethrow it
+    class JENSONSHARED_EXPORT SerializationException : public QException
     {
     private:
         QString _message;
@@ -78,8 +126,13 @@ namespace jenson
         explicit SerializationException(QString &message) throw()
             : _message(message) {}
 
+        const QString& message() const throw() { return _message; }
+
         virtual const char* what() const throw() override { return _message.toStdString().c_str(); }
 
+        virtual void raise() const override { throw *this; }
+        virtual SerializationException* clone() const override { return new SerializationException(*this); }
+
         virtual ~SerializationException() throw() {}
     };
 
@@ -116,32 +169,137 @@ namespace jenson
         };
 
     private:
-        static QMap<QString, const QObject*>& typeMapPriv()
-        {
-            static QMap<QString, const QObject*> tMap;
-            return tMap;
-        }
-        static QMap<QString, const ICustomSerializer*>& serializerMapPriv()
-        {
-            static QMap<QString, const ICustomSerializer*> sMap;
-            return sMap;
-        }
-        static nm_type& nameMapPriv()
+        // Runs read on the global QThreadPool for the asynchronous methods. accept checks the result while it is
+        // still owned by the pool thread (false rejects and deletes it there), report hands it over after the
+        // object graph moved to the calling thread.
+        static void startAsync(QFutureInterfaceBase future, qint64 size,
+                               const std::function<sptr<QObject>(QString*)> &read,
+                               const std::function<bool(const QObject*, QString*)> &accept,
+                               const std::function<void(sptr<QObject>&)> &report);
+        static qint64 fileSize(const QString &path);
+
+        template <typename T>
+        static QFuture<shptr<T>> deserializeAsyncImpl(qint64 size, const std::function<sptr<QObject>(QString*)> &read)
         {
-            static nm_type  nMap;
-            return nMap;
+            QFutureInterface<shptr<T>> future;
+            startAsync(future, size, read, [](const QObject *obj, QString *errorMsg) -> bool
+            {
+                if (qobject_cast<const T*>(obj))
+                    return true;
+
+                errorMsg->append(QString("\n Deserialized ") + obj->metaObject()->className() +
+                                 " is not a " + T::staticMetaObject.className());
+                return false;
+            },
+            [future](sptr<QObject> &obj) mutable
+            {
+                future.reportResult(shptr<T>(qobject_cast<T*>(obj.release())));
+            });
+            return future.future();
         }
 
+        // Adds a class to the registry (Use SERIALIZABLE macro)
+        static void registerClass(const QObject *prototype, const QString &serialName, const ICustomSerializer *serializer,
+                                  const FieldList *fields, const ObjectContainers *containers);
+
     public:
+        // Wire formats of the streaming methods
+        enum Format
+        {
+            Json,
+            Cbor    // Requires the Cbor build option (Qt >= 5.12)
+        };
+
         // Exception throwing methods
         static QJsonObject serialize(const QObject *qObj);
         static sptr<QObject> deserializeToObject(const QJsonObject *jsonObj);
         static sptr<QObject> deserializeClass(const QJsonObject *jsonObj, QString className);
+        static void deserializeInto(QObject *target, const QJsonObject *jsonObj);
 
         // ErrorMsg methods
         static sptr<QObject> deserializeToObject(const QJsonObject *jsonObj, QString *errorMsg);
         static sptr<QObject> deserializeClass(const QJsonObject *jsonObj, QString className, QString *errorMsg);
 
+        // Updates an existing object, jsonObj may be wrapped in the target's serial name or not.
+        // Nested children of the deserialized class are updated in place instead of replaced,
+        // onDeserialized() runs once per updated object after its properties are written.
+        // On failure the target may be partially updated.
+        static bool deserializeInto(QObject *target, const QJsonObject *jsonObj, QString *errorMsg);
+
+        // Delta methods, serializeDelta only contains the properties changed after revision since
+        // (nested objects as partial deltas, replaced ones in full). It polls the tracker first.
+        // applyDelta only writes the properties present in delta, nested objects are updated in place
+        // unless they were replaced.
+        static QJsonObject serializeDelta(const QObject *qObj, ChangeTracker *tracker, quint64 since);
+        static void applyDelta(QObject *target, const QJsonObject *delta);
+        static bool applyDelta(QObject *target, const QJsonObject *delta, QString *errorMsg);
+
+        // Deserializes the pending JENSON_LAZY_PROPERTY values of obj (and of its nested objects if recursive).
+        // Values that fail stay pending (their getters return nullptr), the errors are reported here.
+        static void materialize(QObject *obj, bool recursive = true);
+        static bool materialize(QObject *obj, QString *errorMsg, bool recursive = true);
+
+        // Streaming methods, (de)serialize without building a QJsonObject
+        static void serialize(const QObject *qObj, QByteArray *data, Format format = Json); // Appends to data
+        static void serialize(const QObject *qObj, QIODevice *device, Format format = Json);
+        static sptr<QObject> deserializeFrom(const QByteArray &data, Format format = Json);
+        static sptr<QObject> deserializeFrom(QIODevice *device, Format format = Json);
+        static sptr<QObject> deserializeFrom(const QByteArray &data, QString *errorMsg, Format format = Json);
+        static sptr<QObject> deserializeFrom(QIODevice *device, QString *errorMsg, Format format = Json);
+
+        // File methods, the input is parsed from a memory mapping of the file (read in chunks if it can't
+        // be mapped), the output replaces the file atomically once completely written
+        static void serializeFile(const QObject *qObj, const QString &path, Format format = Json);
+        static bool serializeFile(const QObject *qObj, const QString &path, QString *errorMsg, Format format = Json);
+        static sptr<QObject> deserializeFile(const QString &path, Format format = Json);
+        static sptr<QObject> deserializeFile(const QString &path, QString *errorMsg, Format format = Json);
+
+        // Asynchronous methods, (de)serialize on the global QThreadPool. Deserialized object graphs are moved to
+        // the calling thread. Progress is reported in bytes read (up to progressMaximum(), the input size) or written
+        // (progressMaximum() 0), cancel() stops at the next object. Failed futures rethrow the SerializationException
+        // from result() and waitForFinished(). serializeAsync reads the object into a snapshot on the calling thread
+        // and only encodes it on the pool, the object may change or be deleted as soon as it returns.
+        template <typename T = QObject>
+        static QFuture<shptr<T>> deserializeAsync(const QByteArray &data, Format format = Json)
+        {
+            return deserializeAsyncImpl<T>(data.size(), [data, format](QString *errorMsg)
+                { return deserializeFrom(data, errorMsg, format); });
+        }
+        template <typename T = QObject>
+        static QFuture<shptr<T>> deserializeFileAsync(const QString &path, Format format = Json)
+        {
+            return deserializeAsyncImpl<T>(fileSize(path), [path, format](QString *errorMsg)
+                { return deserializeFile(path, errorMsg, format); });
+        }
+        static QFuture<QByteArray> serializeAsync(const QObject *qObj, Format format = Json);
+
+        // Batch methods, spread over the global QThreadPool, results keep the input order.
+        // Deserialized objects are moved to the calling thread, failed items are nullptr.
+        static QJsonArray serializeMany(const QList<const QObject*> &objects);
+        static std::vector<sptr<QObject>> deserializeMany(const QJsonArray *jsonArray);
+        static std::vector<sptr<QObject>> deserializeMany(const QJsonArray *jsonArray, QString *errorMsg);
+
+        // Parallel mode of deserializeClass (off by default), lists and typed containers with at least minValues
+        // elements and nested objects of sibling properties with at least minValues Json values are built on the
+        // global QThreadPool. The object graph is moved to the calling thread before it is returned. 0 turns it off.
+        // User code then runs concurrently on pool threads: Q_INVOKABLE constructors, property setters, onDeserialized()
+        // and ICustomSerializer::deserialize must be thread-safe. Only the objects jenson creates or custom serializers
+        // return are moved, parentless QObjects that constructors or custom serializers create internally keep the
+        // affinity of the pool thread (parent them to their owner, or leave the threshold at 0 for such classes).
+        static void setParallelThreshold(int minValues);
+        static int parallelThreshold();
+
+        // Per serial name timing of all (de)serialization calls and custom serializer dispatches (off by default).
+        // The trace records every call for writeChromeTrace(), which drains it in the Chrome trace event format
+        // (chrome://tracing, Perfetto). Both are process wide and safe to use from any thread.
+        static void setStatsEnabled(bool enabled);
+        static bool isStatsEnabled();
+        static QHash<QString, ClassStats> stats();
+        static void resetStats();
+        static void setTraceEnabled(bool enabled);
+        static bool isTraceEnabled();
+        static bool writeChromeTrace(QIODevice *device);
+
         // Casting methods
         template <typename T>
         static sptr<T> deserialize(const QJsonObject *jsonObj, QString *errorMsg)
@@ -179,10 +337,66 @@ namespace jenson
             return retVal;
         }
 
-        // Public map getters
-        static const QMap<QString, const QObject*>& typeMap() { return typeMapPriv(); }
-        static const QMap<QString, const ICustomSerializer*>& serializerMap() { return serializerMapPriv(); }
-        static const nm_type& nameMap() { return nameMapPriv(); }
+        template <typename T>
+        static QJsonArray serializeMany(const QList<const T*> &objects)
+        {
+            QList<const QObject*> qObjects;
+            qObjects.reserve(objects.count());
+            foreach (const T *obj, objects) qObjects.append(obj);
+            return serializeMany(qObjects);
+        }
+        template <typename T>
+        static std::vector<sptr<T>> deserializeMany(const QJsonArray *jsonArray)
+        {
+            std::vector<sptr<QObject>> deserialized = deserializeMany(jsonArray);
+            std::vector<sptr<T>> retVal;
+            retVal.reserve(deserialized.size());
+
+            for (sptr<QObject> &obj : deserialized)
+            {
+                if (!qobject_cast<T*>(obj.get()))
+                {
+                    T instance;
+                    QString errorMsg("\n Failed to cast to type: ");
+                    errorMsg.append(instance.metaObject()->className());
+                    throw SerializationException(errorMsg);
+                }
+                retVal.push_back(sptr<T>(static_cast<T*>(obj.release())));
+            }
+            return retVal;
+        }
+
+        // Public map getters (of the current registry snapshot)
+        static const QMap<QString, const QObject*>& typeMap();
+        static const QMap<QString, const ICustomSerializer*>& serializerMap();
+        static const nm_type& nameMap();
+
+        // Registrations never modify a registry snapshot that lookups can see. Before the freeze they are
+        // published together by the next lookup. Freezing builds the plans of all registered types, call it once
+        // the static registrations are done. Afterwards lookups are wait-free from any thread and each late
+        // registration (e.g. plugins) publishes a snapshot that reuses the plans of the unaffected types.
+        static void freezeRegistry();
+        static bool isRegistryFrozen();
+
+        // Type handles, dense integer ids of the registered classes (-1 if not registered).
+        // Handles are stable for the lifetime of the process, resolve them once instead of
+        // repeating class name lookups.
+        typedef int TypeHandle;
+        static TypeHandle typeHandle(const QMetaObject *metaObject);
+        static TypeHandle typeHandle(const QString &className);
+        static TypeHandle typeHandleOfSerialName(const QString &serialName);
+        static int typeCount();
+        static QString className(TypeHandle handle);
+        static QString serialName(TypeHandle handle);
+
+        // Typed fields generated by jenson-gen (Codegen build option) for the JENSON_PROPERTY_GETSET members of
+        // SERIALIZABLE classes, used like JENSON_FIELDS by classes without their own. Disabling them falls back to
+        // the reflective QMetaProperty path, the output is the same. Like a late registration, each change
+        // publishes a registry snapshot that is kept until exit, so it is a setting, not a per call switch.
+        static void registerGeneratedFields(const QMetaObject *metaObject, const FieldList *fields);
+        static void setGeneratedFieldsEnabled(bool enabled);
+        static bool isGeneratedFieldsEnabled();
+        static bool hasGeneratedFields(TypeHandle handle);
 
         // Auxilliary methods
         static bool isRegistered(QString *className, QString *errorMsg = 0);
@@ -197,10 +411,8 @@ namespace jenson
             registerForSerialization(QString serialName, const ICustomSerializer* serializer = nullptr)
             {
                 static const T t;
-                typeMapPriv()[t.metaObject()->className()] = &t;
-                nameMapPriv().insert(nm_type::value_type(t.metaObject()->className(), serialName));
-                if (serializer) serializerMapPriv()[t.metaObject()->className()] = serializer;
                 qRegisterMetaType<T*>();
+                registerClass(&t, serialName, serializer, fieldsOf<T>(), containersOf<T>());
             }
         };
     };
@@ -0,0 +1,173 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson_arena.h"
+
+#include <new>
+#include <QAtomicInt>
+
+using namespace jenson;
+
+
+//
+// Memory layout
+//
+// Every allocation is preceded by a header pointing to its chunk (nullptr for heap allocations).
+// A chunk holds a reference per live allocation plus one for the arena while it is current.
+//
+
+namespace
+{
+    const std::size_t Alignment = 16;
+
+    inline std::size_t alignUp(std::size_t size) { return (size + Alignment - 1) & ~(Alignment - 1); }
+}
+
+struct Arena::Chunk
+{
+    QAtomicInt refs;
+    std::size_t size;
+    std::size_t used;
+
+    char* data() { return reinterpret_cast<char*>(this) + alignUp(sizeof(Chunk)); }
+};
+
+namespace
+{
+    union Header
+    {
+        void *chunk;
+        char pad[Alignment];
+    };
+    static_assert(sizeof(Header) == Alignment, "Allocation header breaks alignment");
+
+    inline Header* headerOf(const void *ptr)
+    {
+        return reinterpret_cast<Header*>(const_cast<char*>(static_cast<const char*>(ptr)) - sizeof(Header));
+    }
+
+    thread_local Arena *t_current = nullptr;
+}
+
+
+//
+// Arena
+//
+
+Arena::Arena(std::size_t chunkSize) :
+    _chunk(nullptr), _chunkSize(alignUp(chunkSize)), _chunkCount(0), _bytesAllocated(0)
+{
+}
+
+Arena::~Arena()
+{
+    if (_chunk)
+        release(_chunk);
+}
+
+void Arena::release(Chunk *chunk)
+{
+    if (!chunk->refs.deref())
+        ::operator delete(chunk);
+}
+
+void* Arena::allocate(std::size_t size)
+{
+    std::size_t needed = sizeof(Header) + alignUp(size);
+
+    // Large objects do not fit a chunk, keep them on the heap
+    if (needed > _chunkSize / 4)
+    {
+        Header *header = static_cast<Header*>(::operator new(needed));
+        header->chunk = nullptr;
+        return header + 1;
+    }
+
+    if (!_chunk || _chunk->used + needed > _chunk->size)
+    {
+        if (_chunk)
+            release(_chunk);
+
+        void *mem = ::operator new(alignUp(sizeof(Chunk)) + _chunkSize);
+        _chunk = new (mem) Chunk();
+        _chunk->refs.store(1);
+        _chunk->size = _chunkSize;
+        _chunk->used = 0;
+        _chunkCount++;
+    }
+
+    Header *header = reinterpret_cast<Header*>(_chunk->data() + _chunk->used);
+    header->chunk = _chunk;
+    _chunk->used += needed;
+    _chunk->refs.ref();
+    _bytesAllocated += needed;
+
+    return header + 1;
+}
+
+void Arena::deallocate(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    Header *header = headerOf(ptr);
+    if (header->chunk)
+        release(static_cast<Chunk*>(header->chunk));
+    else
+        ::operator delete(header);
+}
+
+void* Arena::allocateCurrent(std::size_t size)
+{
+    if (t_current)
+        return t_current->allocate(size);
+
+    Header *header = static_cast<Header*>(::operator new(sizeof(Header) + size));
+    header->chunk = nullptr;
+    return header + 1;
+}
+
+bool Arena::isArenaAllocated(const void *ptr)
+{
+    return ptr && headerOf(ptr)->chunk;
+}
+
+Arena* Arena::current()
+{
+    return t_current;
+}
+
+
+//
+// Arena::Scope
+//
+
+Arena::Scope::Scope(Arena *arena) :
+    _previous(t_current)
+{
+    t_current = arena;
+}
+
+Arena::Scope::~Scope()
+{
+    t_current = _previous;
+}
@@ -0,0 +1,105 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#ifndef JENSON_ARENA_H
+#define JENSON_ARENA_H
+
+#include <cstddef>
+#include "jenson_global.hpp"
+
+//
+// Opt-in arena allocation for deserialized object graphs.
+//
+// Classes declaring JENSON_ARENA_ALLOCATED are allocated from the current thread's
+// arena while an Arena::Scope is active, and from the heap otherwise:
+//
+//     jenson::Arena arena;
+//     {
+//         jenson::Arena::Scope scope(&arena);
+//         graph = jenson::JenSON::deserialize<Graph>(&json);
+//     }
+//
+// Objects are deleted as usual (destructors still run). The memory of a chunk is
+// returned in one piece once all its objects are deleted and the arena moved on
+// or went out of scope, so an arena may be destroyed before its objects.
+//
+
+#define JENSON_ARENA_ALLOCATED \
+    public: \
+    static void* operator new(std::size_t size) { return jenson::Arena::allocateCurrent(size); } \
+    static void operator delete(void *ptr) { jenson::Arena::deallocate(ptr); }
+
+namespace jenson
+{
+    class JENSONSHARED_EXPORT Arena
+    {
+    private:
+        struct Chunk;
+
+        Chunk *_chunk;          // Current chunk, referenced by the arena
+        std::size_t _chunkSize;
+        int _chunkCount;
+        std::size_t _bytesAllocated;
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        static void release(Chunk *chunk);
+
+    public:
+        explicit Arena(std::size_t chunkSize = 64 * 1024);
+        ~Arena();
+
+        // Not thread-safe, an arena is filled from one thread at a time.
+        // Deallocation is thread-safe.
+        void* allocate(std::size_t size);
+        static void deallocate(void *ptr);
+
+        // Allocates from the current thread's arena, or from the heap without one
+        static void* allocateCurrent(std::size_t size);
+
+        // True if ptr (returned by allocate) lives in an arena chunk
+        static bool isArenaAllocated(const void *ptr);
+
+        // The current thread's arena, or nullptr
+        static Arena* current();
+
+        int chunkCount() const { return _chunkCount; }
+        std::size_t bytesAllocated() const { return _bytesAllocated; }
+
+        // Makes arena the current thread's arena while in scope
+        class JENSONSHARED_EXPORT Scope
+        {
+        private:
+            Arena *_previous;
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        public:
+            explicit Scope(Arena *arena);
+            ~Scope();
+        };
+    };
+}
+
+#endif // JENSON_ARENA_H
@@ -0,0 +1,231 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson.h"
+#include "jenson_p.h"
+
+#include <climits>
+#include <exception>
+#include <memory>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include "jenson_format.h"
+
+using namespace jenson;
+
+
+//
+// AsyncProgress
+//
+
+static thread_local AsyncProgress *currentAsyncProgress = nullptr;
+
+// Progress values are ints, larger inputs are reported in 2^shift bytes
+static int progressShift(qint64 size)
+{
+    int shift = 0;
+    while ((size >> shift) > INT_MAX)
+        shift++;
+    return shift;
+}
+
+AsyncProgress::AsyncProgress(QFutureInterfaceBase *future, qint64 size)
+    : _future(future), _previous(currentAsyncProgress), _shift(progressShift(size)),
+      _step(qMax(qint64(64 * 1024), size / 1000)), _next(_step)
+{
+    currentAsyncProgress = this;
+}
+
+AsyncProgress::~AsyncProgress()
+{
+    currentAsyncProgress = _previous;
+}
+
+void AsyncProgress::report(qint64 offset)
+{
+    if (_future->isCanceled())
+        throw Canceled();
+
+    if (offset < _next)
+        return;
+
+    _future->setProgressValue(int(offset >> _shift));
+    _next = offset + _step;
+}
+
+void AsyncProgress::update(const AbstractReader *reader)
+{
+    if (currentAsyncProgress)
+        currentAsyncProgress->report(reader->offset());
+}
+
+void AsyncProgress::update(const AbstractWriter *writer)
+{
+    if (currentAsyncProgress)
+        currentAsyncProgress->report(writer->offset());
+}
+
+
+//
+// Tasks on the global QThreadPool
+//
+
+namespace
+{
+    class AsyncTask : public QRunnable
+    {
+    private:
+        std::function<void()> _fn;
+
+    public:
+        explicit AsyncTask(const std::function<void()> &fn) : _fn(fn) {}
+
+        virtual void run() override { _fn(); }
+    };
+
+    // Runs fn with progress reporting to future, returns false if it failed (errorMsg is appended) or got canceled
+    bool runWithProgress(QFutureInterfaceBase *future, qint64 size, const std::function<bool()> &fn, QString *errorMsg)
+    {
+        if (future->isCanceled())
+            return false;
+
+        AsyncProgress progress(future, size);
+        try
+        {
+            return fn() && !future->isCanceled();
+        }
+        catch (const AsyncProgress::Canceled&)
+        {
+        }
+        catch (const SerializationException &e)
+        {
+            errorMsg->append(e.message());
+        }
+        catch (const std::exception &e)
+        {
+            errorMsg->append(QString("\n ") + e.what());
+        }
+        return false;
+    }
+
+    void reportError(QFutureInterfaceBase *future, QString &errorMsg)
+    {
+        if (!future->isCanceled())
+            future->reportException(SerializationException(errorMsg));
+    }
+}
+
+
+//
+// Asynchronous static class methods
+//
+
+void JenSON::startAsync(QFutureInterfaceBase future, qint64 size,
+                        const std::function<sptr<QObject>(QString*)> &read,
+                        const std::function<bool(const QObject*, QString*)> &accept,
+                        const std::function<void(sptr<QObject>&)> &report)
+{
+    QThread *callerThread = QThread::currentThread();
+    future.setProgressRange(0, int(size >> progressShift(size)));
+    future.reportStarted();
+
+    QThreadPool::globalInstance()->start(new AsyncTask([=]() mutable {
+        QString errorMsg;
+        sptr<QObject> obj;
+
+        {
+            CreatedObjects created;
+            bool ok = runWithProgress(&future, size, [&]() {
+                obj = read(&errorMsg);
+                return obj != nullptr && accept(obj.get(), &errorMsg);
+            }, &errorMsg);
+
+            // Rejected graphs are deleted here, while they still belong to the pool thread
+            if (!ok)
+                obj.reset();
+
+            // Hand the object graph over to the calling thread
+            if (obj)
+            {
+                created.moveToThread(callerThread);
+                if (obj->thread() != callerThread)
+                    obj->moveToThread(callerThread);
+            }
+        }
+
+        if (obj)
+        {
+            report(obj);
+            future.setProgressValue(future.progressMaximum());
+        }
+        else
+        {
+            reportError(&future, errorMsg);
+        }
+
+        future.reportFinished();
+    }));
+}
+
+qint64 JenSON::fileSize(const QString &path)
+{
+    return QFileInfo(path).size();
+}
+
+QFuture<QByteArray> JenSON::serializeAsync(const QObject *qObj, Format format)
+{
+    QFutureInterface<QByteArray> future;
+    future.setProgressRange(0, 0);
+    future.reportStarted();
+
+    // The objects are read into a snapshot on the calling thread, only its encoding runs on the pool
+    QString errorMsg;
+    std::shared_ptr<RecordingWriter> snapshot(new RecordingWriter());
+    if (!runWithProgress(&future, 0, [&]() {
+            writeRoot(snapshot.get(), qObj);
+            return true;
+        }, &errorMsg))
+    {
+        reportError(&future, errorMsg);
+        future.reportFinished();
+        return future.future();
+    }
+
+    QThreadPool::globalInstance()->start(new AsyncTask([=]() mutable {
+        QString errorMsg;
+        QByteArray data;
+
+        if (runWithProgress(&future, 0, [&]() {
+                writeRecording(snapshot.get(), &data, format);
+                return true;
+            }, &errorMsg))
+            future.reportResult(data);
+        else
+            reportError(&future, errorMsg);
+
+        future.reportFinished();
+    }));
+
+    return future.future();
+}
@@ -0,0 +1,257 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson.h"
+#include "jenson_p.h"
+
+#include <exception>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+using namespace jenson;
+
+
+//
+// Parallel loop on the global QThreadPool
+//
+
+namespace
+{
+    struct ParallelState
+    {
+        const std::function<void(int)> *fn;
+        int count;
+        AllocationScope *scope;     // Of the calling thread, counts the items of all threads
+        QAtomicInt next;
+        QSemaphore done;
+        QMutex mutex;
+        std::exception_ptr error;
+
+        void run()
+        {
+            int i;
+            while ((i = next.fetchAndAddRelaxed(1)) < count)
+            {
+                try
+                {
+                    (*fn)(i);
+                }
+                catch (...)
+                {
+                    QMutexLocker locker(&mutex);
+                    if (!error) error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    class ParallelRunnable : public QRunnable
+    {
+    private:
+        ParallelState *_state;
+
+    public:
+        explicit ParallelRunnable(ParallelState *state) : _state(state) {}
+
+        virtual void run() override
+        {
+            if (_state->scope)
+            {
+                AllocationScope scope(_state->scope);
+                _state->run();
+            }
+            else
+            {
+                _state->run();
+            }
+            _state->done.release();
+        }
+    };
+}
+
+void jenson::parallelFor(int count, const std::function<void(int)> &fn)
+{
+    ParallelState state;
+    state.fn = &fn;
+    state.count = count;
+    state.scope = AllocationScope::current();
+    ParallelTiming timing;
+
+    // Only start workers that get a thread right away, the calling thread
+    // processes whatever is left, so nested calls can not deadlock the pool
+    int started = 0;
+    int wanted = qMin(QThreadPool::globalInstance()->maxThreadCount(), count) - 1;
+    for (int i = 0; i < wanted; i++)
+    {
+        ParallelRunnable *runnable = new ParallelRunnable(&state);
+        if (!QThreadPool::globalInstance()->tryStart(runnable))
+        {
+            delete runnable;
+            break;
+        }
+        started++;
+    }
+
+    if (state.scope)
+    {
+        // The workers add their counts to the scope when they end,
+        // the items of this thread are counted apart until then
+        AllocationScope scope(state.scope);
+        state.run();
+        state.done.acquire(started);
+    }
+    else
+    {
+        state.run();
+        state.done.acquire(started);
+    }
+
+    if (state.error)
+        std::rethrow_exception(state.error);
+}
+
+
+QAtomicInt jenson::parallelMinValues;
+
+void jenson::parallelBuild(int count, const std::function<sptr<QObject>(int)> &build, std::vector<sptr<QObject>> *results)
+{
+    results->clear();
+    results->resize(count);
+    sptr<QObject> *resultData = results->data();
+    QThread *callerThread = QThread::currentThread();
+
+    parallelFor(count, [&](int i) {
+        CreatedObjects created;
+        resultData[i] = build(i);
+
+        // Hand the object graph over to the calling thread
+        created.moveToThread(callerThread);
+        if (resultData[i] && resultData[i]->thread() != callerThread)
+            resultData[i]->moveToThread(callerThread);
+    });
+
+    for (const sptr<QObject> &obj : *results)
+        if (obj)
+            CreatedObjects::record(obj.get());
+}
+
+
+//
+// CreatedObjects
+//
+
+static thread_local CreatedObjects *currentCreatedObjects = nullptr;
+
+CreatedObjects::CreatedObjects()
+    : _previous(currentCreatedObjects)
+{
+    currentCreatedObjects = this;
+}
+
+CreatedObjects::~CreatedObjects()
+{
+    currentCreatedObjects = _previous;
+}
+
+void CreatedObjects::record(QObject *obj)
+{
+    if (currentCreatedObjects)
+        currentCreatedObjects->_objects.append(obj);
+}
+
+void CreatedObjects::moveToThread(QThread *thread)
+{
+    foreach (const QPointer<QObject> &obj, _objects)
+        if (obj && !obj->parent() && obj->thread() != thread)
+            obj->moveToThread(thread);
+}
+
+
+//
+// Batch static class methods
+//
+
+QJsonArray JenSON::serializeMany(const QList<const QObject*> &objects)
+{
+    QVector<QJsonObject> results(objects.count());
+    QJsonObject *resultData = results.data();
+
+    parallelFor(objects.count(), [&](int i) {
+        resultData[i] = serialize(objects.at(i));
+    });
+
+    QJsonArray retVal;
+    foreach (const QJsonObject &obj, results)
+        retVal.append(obj);
+    return retVal;
+}
+
+std::vector<sptr<QObject>> JenSON::deserializeMany(const QJsonArray *jsonArray)
+{
+    QString errorMsg;
+    std::vector<sptr<QObject>> retVal = deserializeMany(jsonArray, &errorMsg);
+
+    for (const sptr<QObject> &obj : retVal)
+        if (!obj)
+            throw SerializationException(errorMsg);
+
+    return retVal;
+}
+
+std::vector<sptr<QObject>> JenSON::deserializeMany(const QJsonArray *jsonArray, QString *errorMsg)
+{
+    const int count = jsonArray->count();
+    std::vector<sptr<QObject>> retVal;
+    QVector<QString> errors(count);
+    QString *errorData = errors.data();
+
+    parallelBuild(count, [&](int i) {
+        QJsonObject jsonObj = jsonArray->at(i).toObject();
+        return deserializeToObject(&jsonObj, &errorData[i]);
+    }, &retVal);
+
+    // Failed items are returned as nullptr
+    for (int i = 0; i < count; i++)
+    {
+        if (!retVal[i] && errorMsg)
+        {
+            errorMsg->append("\n Item " + QString::number(i) + ":");
+            errorMsg->append(errors.at(i));
+        }
+    }
+
+    return retVal;
+}
+
+void JenSON::setParallelThreshold(int minValues)
+{
+    jenson::parallelMinValues.storeRelease(qMax(0, minValues));
+}
+
+int JenSON::parallelThreshold()
+{
+    return jenson::parallelMinValues.loadAcquire();
+}
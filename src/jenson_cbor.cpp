@@ -0,0 +1,372 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson_cbor.h"
+
+#ifdef JENSON_CBOR
+
+#include <cstring>
+#include <type_traits>
+#include <QIODevice>
+#include <QtEndian>
+#include <QVector>
+#include "jenson_number.h"
+
+using namespace jenson;
+
+static const int DEVICE_CHUNK = 64 * 1024;
+
+// RFC 8746 typed array tags
+static const quint64 TAG_SINT32_LE = 78;
+static const quint64 TAG_FLOAT32_LE = 85;
+static const quint64 TAG_FLOAT64_LE = 86;
+
+// Appends a typed array, the elements are copied as is on little-endian hosts
+template <typename T>
+static void appendTypedArray(QCborStreamWriter *writer, quint64 tag, const T *values, int count)
+{
+    writer->append(QCborTag(tag));
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    writer->appendByteString(reinterpret_cast<const char*>(values), qsizetype(count) * qsizetype(sizeof(T)));
+#else
+    typedef typename std::conditional<sizeof(T) == 8, quint64, quint32>::type Raw;
+    QByteArray bytes(count * int(sizeof(T)), Qt::Uninitialized);
+    for (int i = 0; i < count; i++)
+    {
+        Raw raw;
+        std::memcpy(&raw, values + i, sizeof(T));
+        qToLittleEndian(raw, bytes.data() + i * sizeof(T));
+    }
+    writer->appendByteString(bytes.constData(), bytes.size());
+#endif
+}
+
+
+//
+// CborWriter
+//
+
+CborWriter::CborWriter(QByteArray *out)
+    : _writer(out), _device(nullptr), _out(out), _flushed(0), _start(out->size()), _error(false)
+{
+}
+
+CborWriter::CborWriter(QIODevice *device)
+    : _writer(&_buffer), _device(device), _out(nullptr), _flushed(0), _start(0), _error(false)
+{
+    _buffer.buffer().reserve(DEVICE_CHUNK + DEVICE_CHUNK / 4);
+    _buffer.open(QIODevice::WriteOnly);
+}
+
+CborWriter::~CborWriter()
+{
+    flush();
+}
+
+void CborWriter::flushIfFull()
+{
+    if (_device && _buffer.size() >= DEVICE_CHUNK)
+        flush();
+}
+
+void CborWriter::writeDouble(double value)
+{
+    if (_precision >= 0)
+        value = number::round(value, _precision);
+
+    // Integral values are written as (smaller) integers, the reader converts them back
+    if (number::isExactInteger(value))
+        _writer.append(qint64(value));
+    else
+        _writer.append(value);
+}
+
+void CborWriter::writeUuid(const QUuid &value)
+{
+    _writer.append(QCborKnownTags::Uuid);
+    _writer.append(value.toRfc4122());
+}
+
+void CborWriter::writeArray(const double *values, int count)
+{
+    if (_precision >= 0)
+    {
+        QVector<double> rounded(count);
+        for (int i = 0; i < count; i++)
+            rounded[i] = number::round(values[i], _precision);
+        appendTypedArray(&_writer, TAG_FLOAT64_LE, rounded.constData(), count);
+    }
+    else
+    {
+        appendTypedArray(&_writer, TAG_FLOAT64_LE, values, count);
+    }
+
+    flushIfFull();
+}
+
+void CborWriter::writeArray(const float *values, int count)
+{
+    if (_precision >= 0)
+    {
+        QVector<float> rounded(count);
+        for (int i = 0; i < count; i++)
+            rounded[i] = float(number::round(values[i], _precision));
+        appendTypedArray(&_writer, TAG_FLOAT32_LE, rounded.constData(), count);
+    }
+    else
+    {
+        appendTypedArray(&_writer, TAG_FLOAT32_LE, values, count);
+    }
+
+    flushIfFull();
+}
+
+void CborWriter::writeArray(const int *values, int count)
+{
+    appendTypedArray(&_writer, TAG_SINT32_LE, values, count);
+    flushIfFull();
+}
+
+bool CborWriter::flush()
+{
+    if (!_device || _buffer.size() == 0)
+        return !_error;
+
+    // A short write (full disk, closed socket) would truncate the document
+    QByteArray &chunk = _buffer.buffer();
+    if (_device->write(chunk) != chunk.size())
+        _error = true;
+    _flushed += chunk.size();
+    chunk.resize(0); // keeps the capacity
+    _buffer.seek(0);
+
+    return !_error;
+}
+
+qint64 CborWriter::offset() const
+{
+    if (_out)
+        return _out->size() - _start;
+    return _flushed + _buffer.size();
+}
+
+
+//
+// CborReader
+//
+
+CborReader::CborReader(const QByteArray &data)
+    : _reader(data), _rootRead(false)
+{
+}
+
+CborReader::CborReader(QIODevice *device)
+    : _reader(device), _rootRead(false)
+{
+}
+
+bool CborReader::readString(QString *out)
+{
+    out->clear();
+
+    QCborStreamReader::StringResult<QString> r = _reader.readString();
+    while (r.status == QCborStreamReader::Ok)
+    {
+        out->append(r.data);
+        r = _reader.readString();
+    }
+
+    return r.status == QCborStreamReader::EndOfString;
+}
+
+bool CborReader::readByteArray(QByteArray *out)
+{
+    out->clear();
+
+    QCborStreamReader::StringResult<QByteArray> r = _reader.readByteArray();
+    while (r.status == QCborStreamReader::Ok)
+    {
+        out->append(r.data);
+        r = _reader.readByteArray();
+    }
+
+    return r.status == QCborStreamReader::EndOfString;
+}
+
+CborReader::Token CborReader::afterValue(Token token)
+{
+    if (_stack.isEmpty())
+        _rootRead = true;
+    else if (_stack.last().isMap)
+        _stack.last().expectKey = true;
+
+    _token = token;
+    return _token;
+}
+
+CborReader::Token CborReader::readScalar()
+{
+    if (_reader.isString())
+    {
+        if (!readString(&_text))
+            return fail("Invalid text string");
+        return afterValue(String);
+    }
+
+    if (_reader.isInteger())
+    {
+        _number = double(_reader.toInteger());
+        _reader.next();
+        return afterValue(Number);
+    }
+
+    if (_reader.isDouble() || _reader.isFloat() || _reader.isFloat16())
+    {
+        if (_reader.isDouble())
+            _number = _reader.toDouble();
+        else if (_reader.isFloat())
+            _number = _reader.toFloat();
+        else
+            _number = _reader.toFloat16();
+        _reader.next();
+        return afterValue(Number);
+    }
+
+    if (_reader.isBool())
+    {
+        _bool = _reader.toBool();
+        _reader.next();
+        return afterValue(Bool);
+    }
+
+    if (_reader.isNull() || _reader.isUndefined())
+    {
+        _reader.next();
+        return afterValue(Null);
+    }
+
+    if (_reader.isTag())
+    {
+        QCborTag tag = _reader.toTag();
+        _reader.next();
+
+        if (tag == QCborTag(QCborKnownTags::Uuid) && _reader.isByteArray())
+        {
+            QByteArray bytes;
+            if (!readByteArray(&bytes))
+                return fail("Invalid uuid byte string");
+            _other = QUuid::fromRfc4122(bytes);
+            return afterValue(Other);
+        }
+
+        // Unknown tags are transparent
+        Packed packed = NotPacked;
+        if (tag == QCborTag(TAG_FLOAT64_LE))
+            packed = PackedDouble;
+        else if (tag == QCborTag(TAG_FLOAT32_LE))
+            packed = PackedFloat;
+        else if (tag == QCborTag(TAG_SINT32_LE))
+            packed = PackedInt;
+
+        Token token = readScalar();
+        if (token == Other && packed != NotPacked && _other.type() == QVariant::ByteArray)
+            _packed = packed;
+        return token;
+    }
+
+    if (_reader.isByteArray())
+    {
+        QByteArray bytes;
+        if (!readByteArray(&bytes))
+            return fail("Invalid byte string");
+
+        _other = bytes;
+        return afterValue(Other);
+    }
+
+    return fail("Unsupported CBOR type");
+}
+
+CborReader::Token CborReader::next()
+{
+    if (_token == Error || _token == EndOfInput)
+        return _token;
+
+    _packed = NotPacked;
+
+    if (_reader.lastError() != QCborError::NoError)
+        return fail("CBOR error: " + _reader.lastError().toString());
+
+    if (_stack.isEmpty() && _rootRead)
+    {
+        if (_reader.isValid())
+            return fail("Unexpected data after the root value");
+        _token = EndOfInput;
+        return _token;
+    }
+
+    // End of the current container
+    if (!_stack.isEmpty() && !_reader.hasNext())
+    {
+        bool isMap = _stack.last().isMap;
+        _stack.removeLast();
+        if (!_reader.leaveContainer())
+            return fail("CBOR error: " + _reader.lastError().toString());
+        return afterValue(isMap ? EndObject : EndArray);
+    }
+
+    // Map keys
+    if (!_stack.isEmpty() && _stack.last().isMap && _stack.last().expectKey)
+    {
+        if (!_reader.isString() || !readString(&_text))
+            return fail("Expected a text string map key");
+        _stack.last().expectKey = false;
+        _token = Key;
+        return _token;
+    }
+
+    if (!_reader.isValid())
+        return fail("Unexpected end of input");
+
+    if (_reader.isMap())
+    {
+        _reader.enterContainer();
+        Container c = { true, true };
+        _stack.append(c);
+        _token = BeginObject;
+        return _token;
+    }
+
+    if (_reader.isArray())
+    {
+        _reader.enterContainer();
+        Container c = { false, false };
+        _stack.append(c);
+        _token = BeginArray;
+        return _token;
+    }
+
+    return readScalar();
+}
+
+#endif // JENSON_CBOR
@@ -0,0 +1,114 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+//
+// Private JenSON header, not part of the public API.
+//
+
+#ifndef JENSON_CBOR_H
+#define JENSON_CBOR_H
+
+#ifdef JENSON_CBOR
+
+#include <QBuffer>
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
+#include <QVector>
+#include "jenson_format.h"
+
+namespace jenson
+{
+    //
+    // CBOR (RFC 7049) writer, objects are written as maps with text string keys.
+    // Integers and doubles are written natively and uuids as tag 37 byte strings.
+    // Numeric arrays are written as RFC 8746 little-endian typed arrays (tags 86, 85 and 78).
+    //
+
+    class CborWriter : public AbstractWriter
+    {
+    private:
+        QBuffer _buffer;        // Device output is written in chunks, like the Json writer
+        QCborStreamWriter _writer;
+        QIODevice *_device;
+        const QByteArray *_out;
+        qint64 _flushed;        // Bytes handed to the device
+        int _start;             // Initial size of *_out
+        bool _error;
+
+        void flushIfFull();
+
+    public:
+        explicit CborWriter(QByteArray *out);
+        explicit CborWriter(QIODevice *device);
+        virtual ~CborWriter();
+
+        virtual void beginObject() override { _writer.startMap(); }
+        virtual void endObject() override { _writer.endMap(); flushIfFull(); }
+        virtual void beginArray() override { _writer.startArray(); }
+        virtual void endArray() override { _writer.endArray(); flushIfFull(); }
+        virtual void writeKey(const QString &key) override { _writer.append(key); }
+
+        virtual void writeNull() override { _writer.appendNull(); }
+        virtual void writeBool(bool value) override { _writer.append(value); }
+        virtual void writeInteger(qint64 value) override { _writer.append(value); }
+        virtual void writeDouble(double value) override;
+        virtual void writeString(const QString &value) override { _writer.append(value); }
+        virtual void writeUuid(const QUuid &value) override;
+
+        virtual void writeArray(const double *values, int count) override;
+        virtual void writeArray(const float *values, int count) override;
+        virtual void writeArray(const int *values, int count) override;
+
+        virtual bool flush() override;
+        virtual qint64 offset() const override;
+    };
+
+    class CborReader : public AbstractReader
+    {
+    private:
+        struct Container
+        {
+            bool isMap;
+            bool expectKey;
+        };
+
+        QCborStreamReader _reader;
+        QVector<Container> _stack;
+        bool _rootRead;
+
+        bool readString(QString *out);
+        bool readByteArray(QByteArray *out);
+        Token readScalar();
+        Token afterValue(Token token);
+
+    public:
+        explicit CborReader(const QByteArray &data);
+        explicit CborReader(QIODevice *device);
+
+        virtual Token next() override;
+        virtual qint64 offset() const override { return _reader.currentOffset(); }
+    };
+}
+
+#endif // JENSON_CBOR
+
+#endif // JENSON_CBOR_H
@@ -0,0 +1,98 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+#ifndef JENSON_CONTAINER_HPP
+#define JENSON_CONTAINER_HPP
+
+#include <QList>
+#include <QObject>
+#include <QVariant>
+#include <QVector>
+
+//
+// Typed container properties, QList<T*> and QVector<T*> of a registered class T.
+//
+//     Q_PROPERTY(QList<Child*> children READ children WRITE setChildren)
+//
+// The elements are (de)serialized as plain objects of class T, without the
+// {"serialName": ...} wrapper and QVariant boxing of QVariantList items.
+// Deserialized elements are parented to the deserialized object, null elements are kept.
+//
+
+namespace jenson
+{
+    class IObjectContainer
+    {
+    public:
+        virtual int count(const QVariant &container) const = 0;
+        virtual QObject* at(const QVariant &container, int i) const = 0;
+
+        // Container of the given objects, all instances of the element class (or nullptr)
+        virtual QVariant fromObjects(QObject *const *objects, int count) const = 0;
+
+        virtual ~IObjectContainer() {}
+    };
+
+    template <typename Container>
+    class ObjectContainer : public IObjectContainer
+    {
+    private:
+        typedef typename Container::value_type Pointer;
+
+        static const Container& get(const QVariant &container)
+            { return *static_cast<const Container*>(container.constData()); }
+
+    public:
+        virtual int count(const QVariant &container) const override
+            { return get(container).count(); }
+        virtual QObject* at(const QVariant &container, int i) const override
+            { return get(container).at(i); }
+
+        virtual QVariant fromObjects(QObject *const *objects, int count) const override
+        {
+            Container typed;
+            typed.reserve(count);
+            for (int i = 0; i < count; i++)
+                typed.append(static_cast<Pointer>(objects[i]));
+            return QVariant::fromValue(typed);
+        }
+    };
+
+    struct ObjectContainers
+    {
+        int listType;                       // QList<T*> meta type id
+        int vectorType;                     // QVector<T*> meta type id
+        const IObjectContainer *list;
+        const IObjectContainer *vector;
+    };
+
+    // Used by registerForSerialization, registers the container meta types of T
+    template <typename T>
+    const ObjectContainers* containersOf()
+    {
+        static const ObjectContainer<QList<T*>> list;
+        static const ObjectContainer<QVector<T*>> vector;
+        static const ObjectContainers containers = { qRegisterMetaType<QList<T*>>(), qRegisterMetaType<QVector<T*>>(), &list, &vector };
+        return &containers;
+    }
+}
+
+#endif // JENSON_CONTAINER_HPP
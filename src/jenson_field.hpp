@@ -0,0 +1,287 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#ifndef JENSON_FIELD_HPP
+#define JENSON_FIELD_HPP
+
+#include <climits>
+#include <type_traits>
+#include <QObject>
+#include <QJsonValue>
+
+//
+// Typed field lists, (de)serialize properties with direct getter/setter calls instead of QVariant.
+//
+// Usage, next to the Q_PROPERTY declarations of a SERIALIZABLE class:
+//
+//     JENSON_PROPERTY_GETSET(qreal, x)
+//     JENSON_PROPERTY_GETSET(Nestedobject*, nestedObj)
+//     JENSON_FIELDS(Testobject, JENSON_FIELD(x), JENSON_FIELD(nestedObj))
+//
+// Fields are matched to properties by name, supported types are
+// bool, int, float, qreal, QString and pointers to QObject subclasses.
+//
+
+#define JENSON_FIELDS(CLASS, ...) \
+    public: \
+    static const jenson::FieldList& jensonFields() { \
+        typedef CLASS jenson_class; \
+        static const jenson::IField *const fields[] = { __VA_ARGS__ }; \
+        static const jenson::FieldList list(fields, sizeof(fields) / sizeof(fields[0])); \
+        return list; \
+    }
+
+// Field using the MEMBERNAME() getter and setMEMBERNAME() setter (as generated by JENSON_GETSET)
+#define JENSON_FIELD(MEMBERNAME) \
+    jenson::makeField(#MEMBERNAME, &jenson_class::MEMBERNAME, &jenson_class::set##MEMBERNAME)
+
+namespace jenson
+{
+    class IField
+    {
+    public:
+        enum Kind { Bool, Integer, Number, String, Object };
+
+        virtual const char* name() const = 0;
+        virtual Kind kind() const = 0;
+
+        // Scalar fields, fromJson returns false if value is not of the field's Json type
+        virtual QJsonValue toJson(const QObject *obj) const = 0;
+        virtual bool fromJson(QObject *obj, const QJsonValue &value) const = 0;
+
+        // Object fields, setObject returns false if value is not of the field's class
+        virtual QObject* object(const QObject *obj) const = 0;
+        virtual bool setObject(QObject *obj, QObject *value) const = 0;
+
+        virtual ~IField() {}
+    };
+
+    class FieldList
+    {
+    private:
+        const IField *const *_fields;
+        int _count;
+
+    public:
+        FieldList(const IField *const *fields, int count) : _fields(fields), _count(count) {}
+
+        int count() const { return _count; }
+        const IField* at(int i) const { return _fields[i]; }
+
+        // Returns nullptr if there is no field with this name
+        const IField* find(const QString &name) const
+        {
+            for (int i = 0; i < _count; i++)
+                if (name == QLatin1String(_fields[i]->name()))
+                    return _fields[i];
+            return nullptr;
+        }
+    };
+
+
+    //
+    // Conversions per field type
+    //
+
+    struct ScalarCodec
+    {
+        template <typename T>
+        static QObject* toObject(const T &) { return nullptr; }
+        template <typename T>
+        static bool fromObject(QObject *, T *) { return false; }
+    };
+
+    template <typename T, typename Enable = void>
+    struct FieldCodec
+    {
+        static_assert(sizeof(T) == 0, "JENSON_FIELD supports bool, int, float, qreal, QString and QObject pointers");
+    };
+
+    template <>
+    struct FieldCodec<bool> : ScalarCodec
+    {
+        static const IField::Kind kind = IField::Bool;
+        static QJsonValue toJson(bool v) { return QJsonValue(v); }
+        static bool fromJson(const QJsonValue &json, bool *v)
+        {
+            if (!json.isBool()) return false;
+            *v = json.toBool();
+            return true;
+        }
+    };
+
+    template <>
+    struct FieldCodec<int> : ScalarCodec
+    {
+        static const IField::Kind kind = IField::Integer;
+        static QJsonValue toJson(int v) { return QJsonValue(v); }
+        static bool fromJson(const QJsonValue &json, int *v)
+        {
+            if (!json.isDouble()) return false;
+            double d = json.toDouble();
+            // Other values use the QVariant conversion rules
+            if (!(d >= INT_MIN && d <= INT_MAX) || d != int(d)) return false;
+            *v = int(d);
+            return true;
+        }
+    };
+
+    template <>
+    struct FieldCodec<double> : ScalarCodec
+    {
+        static const IField::Kind kind = IField::Number;
+        static QJsonValue toJson(double v) { return QJsonValue(v); }
+        static bool fromJson(const QJsonValue &json, double *v)
+        {
+            if (!json.isDouble()) return false;
+            *v = json.toDouble();
+            return true;
+        }
+    };
+
+    template <>
+    struct FieldCodec<float> : ScalarCodec
+    {
+        static const IField::Kind kind = IField::Number;
+        static QJsonValue toJson(float v) { return QJsonValue(double(v)); }
+        static bool fromJson(const QJsonValue &json, float *v)
+        {
+            if (!json.isDouble()) return false;
+            *v = float(json.toDouble());
+            return true;
+        }
+    };
+
+    template <>
+    struct FieldCodec<QString> : ScalarCodec
+    {
+        static const IField::Kind kind = IField::String;
+        static QJsonValue toJson(const QString &v) { return QJsonValue(v); }
+        static bool fromJson(const QJsonValue &json, QString *v)
+        {
+            if (!json.isString()) return false;
+            *v = json.toString();
+            return true;
+        }
+    };
+
+    template <typename T>
+    struct FieldCodec<T*, typename std::enable_if<std::is_base_of<QObject, T>::value>::type>
+    {
+        static const IField::Kind kind = IField::Object;
+        static QJsonValue toJson(T *) { return QJsonValue(QJsonValue::Undefined); }
+        static bool fromJson(const QJsonValue &, T **) { return false; }
+        static QObject* toObject(T *v) { return v; }
+        static bool fromObject(QObject *obj, T **v)
+        {
+            T *typed = qobject_cast<T*>(obj);
+            if (obj && !typed) return false;
+            *v = typed;
+            return true;
+        }
+    };
+
+
+    //
+    // Field implementation, C is the class and T the (decayed) property type
+    //
+
+    template <typename C, typename T, typename Getter, typename Setter>
+    class Field : public IField
+    {
+    private:
+        typedef FieldCodec<T> Codec;
+
+        const char *_name;
+        Getter _get;
+        Setter _set;
+
+        T get(const QObject *obj) const { return (const_cast<C*>(static_cast<const C*>(obj))->*_get)(); }
+
+    public:
+        Field(const char *name, Getter get, Setter set) : _name(name), _get(get), _set(set) {}
+
+        virtual const char* name() const override { return _name; }
+        virtual Kind kind() const override { return Codec::kind; }
+
+        virtual QJsonValue toJson(const QObject *obj) const override
+            { return Codec::toJson(get(obj)); }
+        virtual bool fromJson(QObject *obj, const QJsonValue &value) const override
+        {
+            T v;
+            if (!Codec::fromJson(value, &v))
+                return false;
+            (static_cast<C*>(obj)->*_set)(v);
+            return true;
+        }
+
+        virtual QObject* object(const QObject *obj) const override
+            { return Codec::toObject(get(obj)); }
+        virtual bool setObject(QObject *obj, QObject *value) const override
+        {
+            T v;
+            if (!Codec::fromObject(value, &v))
+                return false;
+            (static_cast<C*>(obj)->*_set)(v);
+            return true;
+        }
+    };
+
+    // Fields live as long as the class' field list (function local statics), they are never freed
+    template <typename C, typename T, typename S>
+    const IField* makeField(const char *name, T (C::*get)() const, void (C::*set)(S))
+    {
+        typedef typename std::decay<T>::type V;
+        return new Field<C, V, T (C::*)() const, void (C::*)(S)>(name, get, set);
+    }
+
+    template <typename C, typename T, typename S>
+    const IField* makeField(const char *name, T (C::*get)(), void (C::*set)(S))
+    {
+        typedef typename std::decay<T>::type V;
+        return new Field<C, V, T (C::*)(), void (C::*)(S)>(name, get, set);
+    }
+
+
+    //
+    // Detection of JENSON_FIELDS, used by registerForSerialization
+    //
+
+    template <typename T>
+    class HasFields
+    {
+    private:
+        template <typename U> static char test(decltype(&U::jensonFields));
+        template <typename U> static long test(...);
+
+    public:
+        static const bool value = sizeof(test<T>(0)) == 1;
+    };
+
+    template <typename T>
+    typename std::enable_if<HasFields<T>::value, const FieldList*>::type fieldsOf() { return &T::jensonFields(); }
+
+    template <typename T>
+    typename std::enable_if<!HasFields<T>::value, const FieldList*>::type fieldsOf() { return nullptr; }
+}
+
+#endif // JENSON_FIELD_HPP
@@ -0,0 +1,413 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson_format.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QtEndian>
+
+using namespace jenson;
+
+
+//
+// AbstractWriter
+//
+
+void AbstractWriter::writeValue(const QJsonValue &value)
+{
+    switch (value.type())
+    {
+    case QJsonValue::Bool:
+        writeBool(value.toBool());
+        break;
+
+    case QJsonValue::Double:
+        writeDouble(value.toDouble());
+        break;
+
+    case QJsonValue::String:
+        writeString(value.toString());
+        break;
+
+    case QJsonValue::Array:
+        beginArray();
+        foreach (const QJsonValue &item, value.toArray())
+            writeValue(item);
+        endArray();
+        break;
+
+    case QJsonValue::Object:
+    {
+        QJsonObject obj = value.toObject();
+        beginObject();
+        for (QJsonObject::const_iterator it = obj.constBegin(); it != obj.constEnd(); ++it)
+        {
+            writeKey(it.key());
+            writeValue(it.value());
+        }
+        endObject();
+        break;
+    }
+
+    default:
+        writeNull();
+        break;
+    }
+}
+
+template <typename T>
+static void writeNumbers(AbstractWriter *writer, const T *values, int count)
+{
+    writer->beginArray();
+    for (int i = 0; i < count; i++)
+        writer->writeDouble(double(values[i]));
+    writer->endArray();
+}
+
+void AbstractWriter::writeArray(const double *values, int count)
+{
+    writeNumbers(this, values, count);
+}
+
+void AbstractWriter::writeArray(const float *values, int count)
+{
+    writeNumbers(this, values, count);
+}
+
+void AbstractWriter::writeArray(const int *values, int count)
+{
+    writeNumbers(this, values, count);
+}
+
+
+//
+// RecordingWriter
+//
+
+RecordingWriter::Token& RecordingWriter::append(Op op)
+{
+    Token token;
+    token.op = op;
+    token.precision = _precision;
+    token.integer = 0;
+    _tokens.append(token);
+    return _tokens.last();
+}
+
+void RecordingWriter::writeKey(const QString &key)
+{
+    append(OpKey).index = _strings.count();
+    _strings.append(key);
+}
+
+void RecordingWriter::writeString(const QString &value)
+{
+    append(OpString).index = _strings.count();
+    _strings.append(value);
+}
+
+void RecordingWriter::writeUuid(const QUuid &value)
+{
+    append(OpUuid).index = _uuids.count();
+    _uuids.append(value);
+}
+
+template <typename T>
+static int appendValues(QVector<QVector<T>> *arrays, const T *values, int count)
+{
+    QVector<T> copy(count);
+    std::copy(values, values + count, copy.begin());
+    arrays->append(copy);
+    return arrays->count() - 1;
+}
+
+void RecordingWriter::writeArray(const double *values, int count)
+{
+    append(OpDoubles).index = appendValues(&_doubles, values, count);
+}
+
+void RecordingWriter::writeArray(const float *values, int count)
+{
+    append(OpFloats).index = appendValues(&_floats, values, count);
+}
+
+void RecordingWriter::writeArray(const int *values, int count)
+{
+    append(OpInts).index = appendValues(&_ints, values, count);
+}
+
+void RecordingWriter::replay(AbstractWriter *writer) const
+{
+    foreach (const Token &token, _tokens)
+    {
+        writer->setPrecision(token.precision);
+
+        switch (token.op)
+        {
+        case OpBeginObject: writer->beginObject(); break;
+        case OpEndObject:   writer->endObject(); break;
+        case OpBeginArray:  writer->beginArray(); break;
+        case OpEndArray:    writer->endArray(); break;
+        case OpKey:         writer->writeKey(_strings.at(token.index)); break;
+        case OpNull:        writer->writeNull(); break;
+        case OpBool:        writer->writeBool(token.boolean); break;
+        case OpInteger:     writer->writeInteger(token.integer); break;
+        case OpDouble:      writer->writeDouble(token.number); break;
+        case OpString:      writer->writeString(_strings.at(token.index)); break;
+        case OpUuid:        writer->writeUuid(_uuids.at(token.index)); break;
+        case OpDoubles:     writer->writeArray(_doubles.at(token.index).constData(), _doubles.at(token.index).count()); break;
+        case OpFloats:      writer->writeArray(_floats.at(token.index).constData(), _floats.at(token.index).count()); break;
+        case OpInts:        writer->writeArray(_ints.at(token.index).constData(), _ints.at(token.index).count()); break;
+        }
+    }
+
+    writer->setPrecision(-1);
+}
+
+
+//
+// AbstractReader
+//
+
+QVariant AbstractReader::variant() const
+{
+    switch (_token)
+    {
+    case String:
+        return _text;
+    case Number:
+        return _number;
+    case Bool:
+        return _bool;
+    case Other:
+        return _other;
+    default:
+        return QVariant();
+    }
+}
+
+QJsonValue AbstractReader::readValue()
+{
+    switch (_token)
+    {
+    case BeginObject:
+    {
+        QJsonObject obj;
+        while (next() == Key)
+        {
+            QString key = _text;
+            next();
+            QJsonValue value = readValue();
+            if (hasError())
+                return QJsonValue(QJsonValue::Undefined);
+            obj.insert(key, value);
+        }
+        if (_token != EndObject)
+            return QJsonValue(QJsonValue::Undefined);
+        return obj;
+    }
+
+    case BeginArray:
+    {
+        QJsonArray array;
+        while (next() != EndArray)
+        {
+            QJsonValue value = readValue();
+            if (hasError())
+                return QJsonValue(QJsonValue::Undefined);
+            array.append(value);
+        }
+        return array;
+    }
+
+    case String:
+        return QJsonValue(_text);
+    case Number:
+        return QJsonValue(_number);
+    case Bool:
+        return QJsonValue(_bool);
+    case Null:
+        return QJsonValue(QJsonValue::Null);
+    case Other:
+        if (_packed != NotPacked)
+        {
+            QVector<double> values;
+            decodePacked(&values);
+            QJsonArray array;
+            foreach (double value, values)
+                array.append(value);
+            return array;
+        }
+        return QJsonValue::fromVariant(_other);
+    default:
+        return QJsonValue(QJsonValue::Undefined);
+    }
+}
+
+bool AbstractReader::nextNumber(double *value)
+{
+    if (next() != Number)
+        return false;
+    *value = _number;
+    return true;
+}
+
+template <typename T>
+bool AbstractReader::readNumbers(QVector<T> *out)
+{
+    out->clear();
+
+    if (_token == Other && _packed != NotPacked)
+        return decodePacked(out);
+
+    if (_token != BeginArray)
+        return false;
+
+    double number;
+    T value;
+    while (nextNumber(&number))
+    {
+        if (!toArrayElement(number, &value))
+            break;
+        out->append(value);
+    }
+
+    if (_token == EndArray)
+        return true;
+
+    // Not a number array, skip the rest of it
+    while (!hasError() && skipValue() && next() != EndArray) {}
+    out->clear();
+    return false;
+}
+
+// Elements of the packed type P, stored little-endian
+template <typename P, typename T>
+static bool decodeElements(const QByteArray &bytes, QVector<T> *out)
+{
+    const int count = bytes.size() / int(sizeof(P));
+    out->resize(count);
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // Same element type, plain copy
+    if (std::is_same<P, T>::value)
+    {
+        std::memcpy(out->data(), bytes.constData(), size_t(count) * sizeof(T));
+        return true;
+    }
+#endif
+
+    typedef typename std::conditional<sizeof(P) == 8, quint64, quint32>::type Raw;
+    for (int i = 0; i < count; i++)
+    {
+        Raw raw = qFromLittleEndian<Raw>(reinterpret_cast<const uchar*>(bytes.constData()) + i * sizeof(P));
+        P element;
+        std::memcpy(&element, &raw, sizeof(P));
+        if (!toArrayElement(double(element), out->data() + i))
+            return false;
+    }
+    return true;
+}
+
+template <typename T>
+bool AbstractReader::decodePacked(QVector<T> *out) const
+{
+    const QByteArray bytes = _other.toByteArray();
+
+    bool ok = false;
+    switch (_packed)
+    {
+    case PackedDouble:
+        ok = decodeElements<double>(bytes, out);
+        break;
+    case PackedFloat:
+        ok = decodeElements<float>(bytes, out);
+        break;
+    case PackedInt:
+        ok = decodeElements<qint32>(bytes, out);
+        break;
+    default:
+        break;
+    }
+
+    if (!ok)
+        out->clear();
+    return ok;
+}
+
+bool AbstractReader::readArray(QVector<double> *out)
+{
+    return readNumbers(out);
+}
+
+bool AbstractReader::readArray(QVector<float> *out)
+{
+    return readNumbers(out);
+}
+
+bool AbstractReader::readArray(QVector<int> *out)
+{
+    return readNumbers(out);
+}
+
+bool AbstractReader::rawValue(QByteArray *source, int *offset, int *length)
+{
+    Q_UNUSED(source)
+    Q_UNUSED(offset)
+    Q_UNUSED(length)
+    return false;
+}
+
+bool AbstractReader::skipValue()
+{
+    int depth = 0;
+
+    forever
+    {
+        switch (_token)
+        {
+        case BeginObject:
+        case BeginArray:
+            depth++;
+            break;
+        case EndObject:
+        case EndArray:
+            depth--;
+            break;
+        case Error:
+        case EndOfInput:
+        case None:
+            return false;
+        default:
+            break;
+        }
+
+        if (depth == 0)
+            return true;
+
+        next();
+    }
+}
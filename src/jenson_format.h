@@ -0,0 +1,252 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+//
+// Private JenSON header, not part of the public API.
+//
+
+#ifndef JENSON_FORMAT_H
+#define JENSON_FORMAT_H
+
+#include <climits>
+#include <QJsonValue>
+#include <QUuid>
+#include <QVariant>
+#include <QVector>
+
+namespace jenson
+{
+    // Conversion of a Json number to a packed array element, false if it does not fit
+    inline bool toArrayElement(double number, double *out) { *out = number; return true; }
+    inline bool toArrayElement(double number, float *out) { *out = float(number); return true; }
+    inline bool toArrayElement(double number, int *out)
+    {
+        if (!(number >= INT_MIN && number <= INT_MAX) || number != int(number))
+            return false;
+        *out = int(number);
+        return true;
+    }
+
+    //
+    // Wire format abstraction used by the streaming (de)serializers.
+    // Values are written and read as a Json-like token stream,
+    // each format encodes them natively (JsonWriter/JsonReader, CborWriter/CborReader).
+    //
+
+    class AbstractWriter
+    {
+    protected:
+        int _precision;
+
+    public:
+        AbstractWriter() : _precision(-1) {}
+
+        // Decimal places of the doubles written next, -1 for the shortest representation that reads back exactly
+        void setPrecision(int precision) { _precision = precision; }
+
+        virtual void beginObject() = 0;
+        virtual void endObject() = 0;
+        virtual void beginArray() = 0;
+        virtual void endArray() = 0;
+        virtual void writeKey(const QString &key) = 0;
+
+        virtual void writeNull() = 0;
+        virtual void writeBool(bool value) = 0;
+        virtual void writeInteger(qint64 value) = 0;
+        virtual void writeDouble(double value) = 0;
+        virtual void writeString(const QString &value) = 0;
+        virtual void writeUuid(const QUuid &value) = 0;
+
+        // Bridge for serializers that produce a QJsonValue
+        virtual void writeValue(const QJsonValue &value);
+
+        // Packed numeric arrays, written as plain number arrays unless the format has a packed encoding
+        virtual void writeArray(const double *values, int count);
+        virtual void writeArray(const float *values, int count);
+        virtual void writeArray(const int *values, int count);
+
+        // Writes buffered output, returns false on write errors
+        virtual bool flush() = 0;
+
+        // Number of bytes written so far (including buffered output)
+        virtual qint64 offset() const = 0;
+
+        virtual ~AbstractWriter() {}
+    };
+
+    // Records the token stream for replay() into another writer. serializeAsync reads the objects into a
+    // recording on the calling thread and encodes it on the pool, the recording refers to none of the objects.
+    class RecordingWriter : public AbstractWriter
+    {
+    private:
+        enum Op
+        {
+            OpBeginObject, OpEndObject, OpBeginArray, OpEndArray, OpKey,
+            OpNull, OpBool, OpInteger, OpDouble, OpString, OpUuid,
+            OpDoubles, OpFloats, OpInts
+        };
+
+        struct Token
+        {
+            Op op;
+            int precision;
+            union
+            {
+                bool boolean;
+                qint64 integer;
+                double number;
+                int index;      // Into the vector of the op
+            };
+        };
+
+        QVector<Token> _tokens;
+        QVector<QString> _strings;      // Keys and strings
+        QVector<QUuid> _uuids;
+        QVector<QVector<double>> _doubles;
+        QVector<QVector<float>> _floats;
+        QVector<QVector<int>> _ints;
+
+        Token& append(Op op);
+
+    public:
+        virtual void beginObject() override { append(OpBeginObject); }
+        virtual void endObject() override { append(OpEndObject); }
+        virtual void beginArray() override { append(OpBeginArray); }
+        virtual void endArray() override { append(OpEndArray); }
+        virtual void writeKey(const QString &key) override;
+
+        virtual void writeNull() override { append(OpNull); }
+        virtual void writeBool(bool value) override { append(OpBool).boolean = value; }
+        virtual void writeInteger(qint64 value) override { append(OpInteger).integer = value; }
+        virtual void writeDouble(double value) override { append(OpDouble).number = value; }
+        virtual void writeString(const QString &value) override;
+        virtual void writeUuid(const QUuid &value) override;
+
+        virtual void writeArray(const double *values, int count) override;
+        virtual void writeArray(const float *values, int count) override;
+        virtual void writeArray(const int *values, int count) override;
+
+        virtual bool flush() override { return true; }
+        virtual qint64 offset() const override { return 0; }
+
+        void replay(AbstractWriter *writer) const;
+    };
+
+    class AbstractReader
+    {
+    public:
+        enum Token
+        {
+            None,
+            BeginObject,
+            EndObject,
+            BeginArray,
+            EndArray,
+            Key,
+            String,
+            Number,
+            Bool,
+            Null,
+            Other,      // Scalar without a Json equivalent (e.g. a CBOR uuid), see variant()
+            EndOfInput,
+            Error
+        };
+
+        // Packed array encodings of Other tokens (the raw little-endian bytes are in variant())
+        enum Packed
+        {
+            NotPacked,
+            PackedDouble,
+            PackedFloat,
+            PackedInt
+        };
+
+    protected:
+        Token _token;
+        QString _text;
+        double _number;
+        bool _bool;
+        QVariant _other;
+        Packed _packed;
+        QString _error;
+        bool _copyRaw;
+
+        AbstractReader() : _token(None), _number(0), _bool(false), _packed(NotPacked), _copyRaw(false) {}
+
+        // Advances to the next array element, returns true if it is a number.
+        // Formats override it to parse number arrays without the token overhead.
+        virtual bool nextNumber(double *value);
+
+        template <typename T> bool readNumbers(QVector<T> *out);
+        template <typename T> bool decodePacked(QVector<T> *out) const;
+
+        Token fail(const QString &message)
+        {
+            _error = message + " at offset " + QString::number(offset());
+            _token = Error;
+            return _token;
+        }
+
+    public:
+        // Advances to the next token
+        virtual Token next() = 0;
+        Token token() const { return _token; }
+
+        // Key and String tokens
+        const QString& text() const { return _text; }
+        // Number tokens
+        double number() const { return _number; }
+        // Bool tokens
+        bool boolean() const { return _bool; }
+
+        // Returns the scalar at the current token as a QVariant
+        QVariant variant() const;
+        Packed packed() const { return _token == Other ? _packed : NotPacked; }
+
+        // Reads the number array (or packed array) at the current token, returns false
+        // if the value is not an array of numbers fitting T (the reader is after the value)
+        bool readArray(QVector<double> *out);
+        bool readArray(QVector<float> *out);
+        bool readArray(QVector<int> *out);
+
+        // Reads the complete value starting at the current token into a QJsonValue (DOM bridge)
+        QJsonValue readValue();
+        // Skips the complete value starting at the current token
+        bool skipValue();
+
+        // Skips the object or array starting at the current token without decoding it, its encoded bytes are
+        // [offset, offset + length) of source. source shares the input buffer unless the input is a device or
+        // setCopyRawValues(true) was called. Returns false if the format or token has no raw value (the reader
+        // did not move) or on errors (hasError()).
+        virtual bool rawValue(QByteArray *source, int *offset, int *length);
+        // The input buffer is only valid during the call (e.g. a file mapping), raw values are copied from it
+        void setCopyRawValues(bool copy) { _copyRaw = copy; }
+
+        bool hasError() const { return _token == Error; }
+        QString errorString() const { return _error; }
+        virtual qint64 offset() const = 0;
+
+        virtual ~AbstractReader() {}
+    };
+}
+
+#endif // JENSON_FORMAT_H
@@ -0,0 +1,144 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson_lazy.h"
+
+#include "jenson.h"
+#include "jenson_p.h"
+#include "jenson_reader.h"
+
+using namespace jenson;
+
+
+//
+// LazyObject
+//
+
+QJsonValue LazyObject::pendingJson() const
+{
+    if (!_pending)
+        return QJsonValue(QJsonValue::Undefined);
+    if (_source.isNull())
+        return _json;
+
+    JsonReader reader(QByteArray::fromRawData(_source.constData() + _offset, _length));
+    reader.next();
+    QJsonValue json = reader.readValue();
+    return reader.hasError() ? QJsonValue(QJsonValue::Undefined) : json;
+}
+
+QObject* LazyObject::get(const QMetaObject *metaObject, const QObject *owner)
+{
+    if (!_pending)
+        return _object;
+    if (!_error.isEmpty())
+        return nullptr; // Failed before, not retried
+
+    QJsonObject jsonObj = pendingJson().toObject();
+    QString errorMsg;
+
+    // Same class resolution as eager nested objects
+    sptr<QObject> obj;
+    try
+    {
+        if (resolveSerialName(jsonObj.count() == 1 ? jsonObj.begin().key() : QString(), nullptr))
+            obj = JenSON::deserializeToObject(&jsonObj, &errorMsg);
+        else
+            obj = JenSON::deserializeClass(&jsonObj, metaObject->className(), &errorMsg);
+    }
+    catch (const SerializationException &e)
+    {
+        errorMsg.append(e.message());
+    }
+
+    if (obj && !metaObject->cast(obj.get()))
+    {
+        errorMsg.append("\n Failed to cast to type: ");
+        errorMsg.append(metaObject->className());
+        obj.reset();
+    }
+
+    if (!obj)
+    {
+        _error = "Lazy deserialization failed:" + errorMsg;
+        return nullptr;
+    }
+
+    set(obj.release());
+    _object->setParent(const_cast<QObject*>(owner));
+
+    return _object;
+}
+
+
+//
+// JenSON lazy methods
+//
+
+void JenSON::materialize(QObject *obj, bool recursive)
+{
+    QString errorMsg;
+    if (!materialize(obj, &errorMsg, recursive))
+        throw SerializationException(errorMsg);
+}
+
+bool JenSON::materialize(QObject *obj, QString *errorMsg, bool recursive)
+{
+    const ClassPlan *plan = ClassPlan::get(obj->metaObject());
+    bool ok = true;
+
+    foreach (const PropertyPlan &prop, plan->readable)
+    {
+        if (!prop.lazyGet.isValid() && !(recursive && prop.type == QVariant::UserType))
+            continue;
+
+        if (prop.container)
+        {
+            const QVariant elements = prop.property.read(obj);
+            for (int i = 0; recursive && i < prop.container->count(elements); i++)
+            {
+                QObject *element = prop.container->at(elements, i);
+                if (element && element != obj && !materialize(element, errorMsg, true))
+                    ok = false;
+            }
+            continue;
+        }
+
+        // Reading a lazy property materializes it
+        QObject *nestedObj = nestedObject(obj, prop);
+        if (prop.lazyError.isValid())
+        {
+            QString lazyError;
+            prop.lazyError.invoke(obj, Qt::DirectConnection, Q_RETURN_ARG(QString, lazyError));
+            if (!lazyError.isEmpty())
+            {
+                if (errorMsg) errorMsg->append("\n " + prop.key + ": " + lazyError);
+                ok = false;
+            }
+        }
+
+        if (recursive && nestedObj && nestedObj != obj && !materialize(nestedObj, errorMsg, true))
+            ok = false;
+    }
+
+    return ok;
+}
@@ -0,0 +1,122 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#ifndef JENSON_LAZY_H
+#define JENSON_LAZY_H
+
+#include <QObject>
+#include <QJsonValue>
+#include "jenson_global.hpp"
+
+//
+// Lazily deserialized nested object property.
+// Deserialization stores the nested Json, the object is built on the first getter call
+// (or by JenSON::materialize). Unmaterialized values are serialized from the stored Json.
+// The streaming reader stores the raw Json text, it is only parsed when it is used.
+// A getter that fails to deserialize returns nullptr and keeps the Json, JenSON::materialize reports why.
+//
+#define JENSON_LAZY_PROPERTY(CLASS, MEMBERNAME) \
+    Q_PROPERTY(CLASS* MEMBERNAME READ MEMBERNAME WRITE set##MEMBERNAME) \
+    private: mutable jenson::Lazy<CLASS> _##MEMBERNAME; \
+    public: \
+    CLASS* MEMBERNAME() const { \
+        return _##MEMBERNAME.get(this); \
+    } \
+    void set##MEMBERNAME(CLASS* value) { \
+        _##MEMBERNAME.set(value); \
+    } \
+    Q_INVOKABLE QJsonValue jensonLazy_##MEMBERNAME() const { return _##MEMBERNAME.pendingJson(); } \
+    Q_INVOKABLE void jensonLazy_##MEMBERNAME(const QJsonValue &json) { _##MEMBERNAME.setPending(json); } \
+    Q_INVOKABLE void jensonLazy_##MEMBERNAME(const QByteArray &source, int offset, int length) \
+        { _##MEMBERNAME.setPending(source, offset, length); } \
+    Q_INVOKABLE QString jensonLazyError_##MEMBERNAME() const { return _##MEMBERNAME.errorString(); }
+
+namespace jenson
+{
+    // Not thread-safe, like the owning QObject
+    class JENSONSHARED_EXPORT LazyObject
+    {
+    private:
+        QObject *_object;
+        QJsonValue _json;
+        QByteArray _source;     // Raw Json [_offset, _offset + _length) of the streaming input, null otherwise
+        int _offset;
+        int _length;
+        bool _pending;
+        QString _error;         // Why the pending Json failed to deserialize
+
+    protected:
+        // Deserializes the pending Json as metaObject's class (unless the Json specifies its class),
+        // the object becomes a child of owner. Getters run inside moc code and QMetaProperty::read, so
+        // it does not throw: on failure it returns nullptr, the Json stays pending and errorString() is set.
+        QObject* get(const QMetaObject *metaObject, const QObject *owner);
+
+    public:
+        LazyObject() : _object(nullptr), _offset(0), _length(0), _pending(false) {}
+
+        bool isPending() const { return _pending; }
+        QString errorString() const { return _error; }
+
+        // The stored Json, undefined if materialized (or if the raw Json is invalid)
+        QJsonValue pendingJson() const;
+
+        void setPending(const QJsonValue &json)
+        {
+            _object = nullptr;
+            _json = json;
+            _source = QByteArray();
+            _pending = true;
+            _error.clear();
+        }
+
+        // Shares source, the raw Json is not copied
+        void setPending(const QByteArray &source, int offset, int length)
+        {
+            _object = nullptr;
+            _json = QJsonValue();
+            _source = source;
+            _offset = offset;
+            _length = length;
+            _pending = true;
+            _error.clear();
+        }
+
+        void set(QObject *object)
+        {
+            _object = object;
+            _json = QJsonValue();
+            _source = QByteArray();
+            _pending = false;
+            _error.clear();
+        }
+    };
+
+    template <typename T>
+    class Lazy : public LazyObject
+    {
+    public:
+        T* get(const QObject *owner) { return static_cast<T*>(LazyObject::get(&T::staticMetaObject, owner)); }
+        void set(T *object) { LazyObject::set(object); }
+    };
+}
+
+#endif // JENSON_LAZY_H
@@ -0,0 +1,361 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+#include "jenson_metrics.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include "jenson_p.h"
+#include "jenson_writer.h"
+
+using namespace jenson;
+
+QAtomicInt jenson::timingFlags;
+
+namespace
+{
+    // Events kept per thread until the next writeChromeTrace(), later events are dropped
+    const int MaxTraceEvents = 1 << 20;
+
+    struct TraceEvent
+    {
+        const QMetaObject *metaObject;
+        OperationStats ClassStats::*operation;
+        qint64 start;
+        qint64 duration;
+        qint64 bytes;
+    };
+
+    struct ThreadStats
+    {
+        QMutex mutex;   // Uncontended, except while taking a snapshot
+        QHash<const QMetaObject*, ClassStats> counters;
+        QVector<TraceEvent> events;
+        int tid;
+
+        ThreadStats();
+        ~ThreadStats();
+    };
+
+    // Registered threads, exited threads leave their results behind in counters and events
+    struct Global
+    {
+        QMutex mutex;
+        QList<ThreadStats*> threads;
+        QHash<const QMetaObject*, ClassStats> counters;
+        QVector<QPair<int, TraceEvent>> events;
+        int nextTid;
+
+        Global() : nextTid(0) {}
+    };
+
+    // Never destroyed, pool threads may exit after the static destructors ran
+    Global& global()
+    {
+        static Global *g = new Global();
+        return *g;
+    }
+
+    // Monotonic nanoseconds since the first call
+    qint64 now()
+    {
+        struct Clock
+        {
+            QElapsedTimer timer;
+            Clock() { timer.start(); }
+        };
+        static const Clock clock;
+        return clock.timer.nsecsElapsed();
+    }
+
+    ThreadStats::ThreadStats()
+    {
+        Global &g = global();
+        QMutexLocker locker(&g.mutex);
+        tid = ++g.nextTid;
+        g.threads.append(this);
+    }
+
+    ThreadStats::~ThreadStats()
+    {
+        Global &g = global();
+        QMutexLocker locker(&g.mutex);
+        g.threads.removeOne(this);
+        for (QHash<const QMetaObject*, ClassStats>::const_iterator it = counters.constBegin(); it != counters.constEnd(); ++it)
+            g.counters[it.key()] += it.value();
+        for (const TraceEvent &event : events)
+            g.events.append(qMakePair(tid, event));
+    }
+
+    thread_local ThreadStats t_stats;
+    thread_local Timing *t_current = nullptr;  // Innermost active Timing, for the self times
+
+    void setFlag(int flag, bool enabled)
+    {
+        int flags;
+        do
+        {
+            flags = timingFlags.loadAcquire();
+        }
+        while (!timingFlags.testAndSetOrdered(flags, enabled ? (flags | flag) : (flags & ~flag)));
+    }
+
+    QString operationName(OperationStats ClassStats::*operation)
+    {
+        if (operation == &ClassStats::serialize)
+            return "serialize";
+        if (operation == &ClassStats::deserialize)
+            return "deserialize";
+        if (operation == &ClassStats::customSerialize)
+            return "customSerialize";
+        return "customDeserialize";
+    }
+
+    QString serialNameOf(const QMetaObject *metaObject)
+    {
+        const ClassPlan *plan = ClassPlan::get(metaObject);
+        return plan ? plan->serialName : QString(metaObject->className());
+    }
+}
+
+
+//
+// OperationStats, ClassStats
+//
+
+OperationStats& OperationStats::operator+=(const OperationStats &other)
+{
+    calls += other.calls;
+    totalNs += other.totalNs;
+    selfNs += other.selfNs;
+    maxNs = qMax(maxNs, other.maxNs);
+    bytes += other.bytes;
+    return *this;
+}
+
+ClassStats& ClassStats::operator+=(const ClassStats &other)
+{
+    serialize += other.serialize;
+    deserialize += other.deserialize;
+    customSerialize += other.customSerialize;
+    customDeserialize += other.customDeserialize;
+    return *this;
+}
+
+
+//
+// Timing
+//
+
+void Timing::begin(const QMetaObject *metaObject, OperationStats ClassStats::*operation,
+                   const AbstractReader *reader, const AbstractWriter *writer, int flags)
+{
+    if (!metaObject)
+        return;
+
+    _metaObject = metaObject;
+    _operation = operation;
+    _reader = reader;
+    _writer = writer;
+    _parent = t_current;
+    _offset = reader ? reader->offset() : writer ? writer->offset() : 0;
+    _childNs = 0;
+    _flags = flags;
+    t_current = this;
+    _start = now();
+}
+
+void Timing::end()
+{
+    const qint64 duration = now() - _start;
+    const qint64 bytes = _reader ? _reader->offset() - _offset : _writer ? _writer->offset() - _offset : 0;
+
+    t_current = _parent;
+    if (_parent)
+        _parent->_childNs += duration;
+
+    ThreadStats &ts = t_stats;
+    QMutexLocker locker(&ts.mutex);
+
+    if (_flags & TimingStats)
+    {
+        OperationStats &stats = ts.counters[_metaObject].*_operation;
+        stats.calls++;
+        stats.totalNs += duration;
+        stats.selfNs += duration - _childNs;
+        stats.maxNs = qMax(stats.maxNs, duration);
+        stats.bytes += bytes;
+    }
+
+    if ((_flags & TimingTrace) && ts.events.size() < MaxTraceEvents)
+    {
+        TraceEvent event = { _metaObject, _operation, _start, duration, bytes };
+        ts.events.append(event);
+    }
+}
+
+
+//
+// ParallelTiming
+//
+
+ParallelTiming::ParallelTiming()
+    : _timing(t_current), _start(0), _childNs(0)
+{
+    if (_timing)
+    {
+        _start = now();
+        _childNs = _timing->_childNs;
+    }
+}
+
+ParallelTiming::~ParallelTiming()
+{
+    // The items of the calling thread already added their time, replace it by the whole section
+    if (_timing)
+        _timing->_childNs = _childNs + (now() - _start);
+}
+
+
+//
+// JenSON stats and trace
+//
+
+void JenSON::setStatsEnabled(bool enabled)
+{
+    setFlag(TimingStats, enabled);
+}
+
+bool JenSON::isStatsEnabled()
+{
+    return timingFlags.loadAcquire() & TimingStats;
+}
+
+QHash<QString, ClassStats> JenSON::stats()
+{
+    QHash<const QMetaObject*, ClassStats> counters;
+    {
+        Global &g = global();
+        QMutexLocker locker(&g.mutex);
+        counters = g.counters;
+        for (ThreadStats *ts : g.threads)
+        {
+            QMutexLocker threadLocker(&ts->mutex);
+            for (QHash<const QMetaObject*, ClassStats>::const_iterator it = ts->counters.constBegin(); it != ts->counters.constEnd(); ++it)
+                counters[it.key()] += it.value();
+        }
+    }
+
+    QHash<QString, ClassStats> retVal;
+    for (QHash<const QMetaObject*, ClassStats>::const_iterator it = counters.constBegin(); it != counters.constEnd(); ++it)
+        retVal[serialNameOf(it.key())] += it.value();
+    return retVal;
+}
+
+void JenSON::resetStats()
+{
+    Global &g = global();
+    QMutexLocker locker(&g.mutex);
+    g.counters.clear();
+    for (ThreadStats *ts : g.threads)
+    {
+        QMutexLocker threadLocker(&ts->mutex);
+        ts->counters.clear();
+    }
+}
+
+void JenSON::setTraceEnabled(bool enabled)
+{
+    setFlag(TimingTrace, enabled);
+}
+
+bool JenSON::isTraceEnabled()
+{
+    return timingFlags.loadAcquire() & TimingTrace;
+}
+
+bool JenSON::writeChromeTrace(QIODevice *device)
+{
+    QVector<QPair<int, TraceEvent>> events;
+    {
+        Global &g = global();
+        QMutexLocker locker(&g.mutex);
+        events.swap(g.events);
+        for (ThreadStats *ts : g.threads)
+        {
+            QMutexLocker threadLocker(&ts->mutex);
+            for (const TraceEvent &event : ts->events)
+                events.append(qMakePair(ts->tid, event));
+            ts->events.clear();
+        }
+    }
+
+    // Complete ("X") events, timestamps and durations in microseconds
+    const qint64 pid = QCoreApplication::applicationPid();
+    QHash<const QMetaObject*, QString> names;
+
+    JsonWriter writer(device);
+    writer.beginObject();
+    writer.writeKey("traceEvents");
+    writer.beginArray();
+    for (const QPair<int, TraceEvent> &item : events)
+    {
+        const TraceEvent &event = item.second;
+        QHash<const QMetaObject*, QString>::const_iterator name = names.constFind(event.metaObject);
+        if (name == names.constEnd())
+            name = names.insert(event.metaObject, serialNameOf(event.metaObject));
+
+        writer.beginObject();
+        writer.writeKey("name");
+        writer.writeString(name.value());
+        writer.writeKey("cat");
+        writer.writeString(operationName(event.operation));
+        writer.writeKey("ph");
+        writer.writeString("X");
+        writer.writeKey("ts");
+        writer.writeDouble(event.start / 1000.0);
+        writer.writeKey("dur");
+        writer.writeDouble(event.duration / 1000.0);
+        writer.writeKey("pid");
+        writer.writeInteger(pid);
+        writer.writeKey("tid");
+        writer.writeInteger(item.first);
+        if (event.bytes)
+        {
+            writer.writeKey("args");
+            writer.beginObject();
+            writer.writeKey("bytes");
+            writer.writeInteger(event.bytes);
+            writer.endObject();
+        }
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.writeKey("displayTimeUnit");
+    writer.writeString("ns");
+    writer.endObject();
+
+    return writer.flush();
+}
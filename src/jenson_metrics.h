@@ -0,0 +1,68 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+#ifndef JENSON_METRICS_H
+#define JENSON_METRICS_H
+
+#include <QtGlobal>
+#include "jenson_global.hpp"
+
+//
+// Opt-in timing of (de)serialization calls, see JenSON::setStatsEnabled().
+//
+// Every (de)serialized object is counted under its serial name, on any thread. Nested objects
+// are included in totalNs and excluded from selfNs of their parents, also when built on pool threads:
+//
+//     jenson::JenSON::setStatsEnabled(true);
+//     ...
+//     jenson::ClassStats stats = jenson::JenSON::stats().value("Testobject");
+//     qint64 average = stats.deserialize.totalNs / stats.deserialize.calls;
+//
+// Disabled (the default) the instrumented call sites only test one flag.
+//
+
+namespace jenson
+{
+    struct JENSONSHARED_EXPORT OperationStats
+    {
+        quint64 calls;
+        qint64 totalNs;         // Including nested objects
+        qint64 selfNs;          // Excluding nested objects
+        qint64 maxNs;           // Slowest call (totalNs)
+        qint64 bytes;           // Produced or consumed, streaming (de)serialization only
+
+        OperationStats() : calls(0), totalNs(0), selfNs(0), maxNs(0), bytes(0) {}
+
+        OperationStats& operator+=(const OperationStats &other);
+    };
+
+    struct JENSONSHARED_EXPORT ClassStats
+    {
+        OperationStats serialize;
+        OperationStats deserialize;
+        OperationStats customSerialize;     // Dispatches to the ICustomSerializer of the class
+        OperationStats customDeserialize;
+
+        ClassStats& operator+=(const ClassStats &other);
+    };
+}
+
+#endif // JENSON_METRICS_H
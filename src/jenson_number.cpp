@@ -0,0 +1,596 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+#include "jenson_number.h"
+
+#include <cmath>
+#include <cstring>
+#include <QByteArray>
+#include <QtGlobal>
+
+using namespace jenson;
+
+//
+// Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers").
+// The digits are the shortest within the rounding interval of the value in nearly all cases
+// and always read back as the same value.
+//
+
+namespace
+{
+    struct DiyFp
+    {
+        quint64 f;
+        int e;
+
+        DiyFp(quint64 f, int e) : f(f), e(e) {}
+
+        static DiyFp sub(const DiyFp &x, const DiyFp &y) { return DiyFp(x.f - y.f, x.e); }
+
+        // Rounded upper 64 bits of the 128 bit product
+        static DiyFp mul(const DiyFp &x, const DiyFp &y)
+        {
+            const quint64 xLo = x.f & 0xffffffffu, xHi = x.f >> 32;
+            const quint64 yLo = y.f & 0xffffffffu, yHi = y.f >> 32;
+
+            const quint64 ll = xLo * yLo, lh = xLo * yHi;
+            const quint64 hl = xHi * yLo, hh = xHi * yHi;
+
+            quint64 mid = (ll >> 32) + (lh & 0xffffffffu) + (hl & 0xffffffffu);
+            mid += quint64(1) << 31; // Round
+
+            return DiyFp(hh + (lh >> 32) + (hl >> 32) + (mid >> 32), x.e + y.e + 64);
+        }
+
+        static DiyFp normalize(DiyFp x)
+        {
+            while ((x.f >> 63) == 0)
+            {
+                x.f <<= 1;
+                x.e--;
+            }
+            return x;
+        }
+
+        static DiyFp normalizeTo(const DiyFp &x, int e)
+        {
+            return DiyFp(x.f << (x.e - e), e);
+        }
+    };
+
+    struct Boundaries
+    {
+        DiyFp w, minus, plus;
+    };
+
+    // Normalized value and the boundaries of its rounding interval, Precision is the number of significand bits
+    template <int Precision, int MaxExponent>
+    Boundaries computeBoundaries(quint64 bits)
+    {
+        const int bias = MaxExponent - 1 + (Precision - 1);
+        const int minExp = 1 - bias;
+        const quint64 hiddenBit = quint64(1) << (Precision - 1);
+
+        const quint64 E = bits >> (Precision - 1);
+        const quint64 F = bits & (hiddenBit - 1);
+
+        const DiyFp v = (E == 0) ? DiyFp(F, minExp) : DiyFp(F + hiddenBit, int(E) - bias);
+
+        // The lower boundary is closer for powers of two (except the smallest normal)
+        const bool lowerCloser = F == 0 && E > 1;
+        const DiyFp mPlus(2 * v.f + 1, v.e - 1);
+        const DiyFp mMinus = lowerCloser ? DiyFp(4 * v.f - 1, v.e - 2) : DiyFp(2 * v.f - 1, v.e - 1);
+
+        const DiyFp wPlus = DiyFp::normalize(mPlus);
+        Boundaries b = { DiyFp::normalize(v), DiyFp::normalizeTo(mMinus, wPlus.e), wPlus };
+        return b;
+    }
+
+    struct CachedPower
+    {
+        quint64 f;
+        int e;
+        int k;
+    };
+
+    // Normalized 10^k for k = -300, -292, ..., 324
+    const CachedPower cachedPowers[] =
+    {
+        { 0xAB70FE17C79AC6CAULL, -1060, -300 },
+        { 0xFF77B1FCBEBCDC4FULL, -1034, -292 },
+        { 0xBE5691EF416BD60CULL, -1007, -284 },
+        { 0x8DD01FAD907FFC3CULL, -980, -276 },
+        { 0xD3515C2831559A83ULL, -954, -268 },
+        { 0x9D71AC8FADA6C9B5ULL, -927, -260 },
+        { 0xEA9C227723EE8BCBULL, -901, -252 },
+        { 0xAECC49914078536DULL, -874, -244 },
+        { 0x823C12795DB6CE57ULL, -847, -236 },
+        { 0xC21094364DFB5637ULL, -821, -228 },
+        { 0x9096EA6F3848984FULL, -794, -220 },
+        { 0xD77485CB25823AC7ULL, -768, -212 },
+        { 0xA086CFCD97BF97F4ULL, -741, -204 },
+        { 0xEF340A98172AACE5ULL, -715, -196 },
+        { 0xB23867FB2A35B28EULL, -688, -188 },
+        { 0x84C8D4DFD2C63F3BULL, -661, -180 },
+        { 0xC5DD44271AD3CDBAULL, -635, -172 },
+        { 0x936B9FCEBB25C996ULL, -608, -164 },
+        { 0xDBAC6C247D62A584ULL, -582, -156 },
+        { 0xA3AB66580D5FDAF6ULL, -555, -148 },
+        { 0xF3E2F893DEC3F126ULL, -529, -140 },
+        { 0xB5B5ADA8AAFF80B8ULL, -502, -132 },
+        { 0x87625F056C7C4A8BULL, -475, -124 },
+        { 0xC9BCFF6034C13053ULL, -449, -116 },
+        { 0x964E858C91BA2655ULL, -422, -108 },
+        { 0xDFF9772470297EBDULL, -396, -100 },
+        { 0xA6DFBD9FB8E5B88FULL, -369, -92 },
+        { 0xF8A95FCF88747D94ULL, -343, -84 },
+        { 0xB94470938FA89BCFULL, -316, -76 },
+        { 0x8A08F0F8BF0F156BULL, -289, -68 },
+        { 0xCDB02555653131B6ULL, -263, -60 },
+        { 0x993FE2C6D07B7FACULL, -236, -52 },
+        { 0xE45C10C42A2B3B06ULL, -210, -44 },
+        { 0xAA242499697392D3ULL, -183, -36 },
+        { 0xFD87B5F28300CA0EULL, -157, -28 },
+        { 0xBCE5086492111AEBULL, -130, -20 },
+        { 0x8CBCCC096F5088CCULL, -103, -12 },
+        { 0xD1B71758E219652CULL, -77, -4 },
+        { 0x9C40000000000000ULL, -50, 4 },
+        { 0xE8D4A51000000000ULL, -24, 12 },
+        { 0xAD78EBC5AC620000ULL, 3, 20 },
+        { 0x813F3978F8940984ULL, 30, 28 },
+        { 0xC097CE7BC90715B3ULL, 56, 36 },
+        { 0x8F7E32CE7BEA5C70ULL, 83, 44 },
+        { 0xD5D238A4ABE98068ULL, 109, 52 },
+        { 0x9F4F2726179A2245ULL, 136, 60 },
+        { 0xED63A231D4C4FB27ULL, 162, 68 },
+        { 0xB0DE65388CC8ADA8ULL, 189, 76 },
+        { 0x83C7088E1AAB65DBULL, 216, 84 },
+        { 0xC45D1DF942711D9AULL, 242, 92 },
+        { 0x924D692CA61BE758ULL, 269, 100 },
+        { 0xDA01EE641A708DEAULL, 295, 108 },
+        { 0xA26DA3999AEF774AULL, 322, 116 },
+        { 0xF209787BB47D6B85ULL, 348, 124 },
+        { 0xB454E4A179DD1877ULL, 375, 132 },
+        { 0x865B86925B9BC5C2ULL, 402, 140 },
+        { 0xC83553C5C8965D3DULL, 428, 148 },
+        { 0x952AB45CFA97A0B3ULL, 455, 156 },
+        { 0xDE469FBD99A05FE3ULL, 481, 164 },
+        { 0xA59BC234DB398C25ULL, 508, 172 },
+        { 0xF6C69A72A3989F5CULL, 534, 180 },
+        { 0xB7DCBF5354E9BECEULL, 561, 188 },
+        { 0x88FCF317F22241E2ULL, 588, 196 },
+        { 0xCC20CE9BD35C78A5ULL, 614, 204 },
+        { 0x98165AF37B2153DFULL, 641, 212 },
+        { 0xE2A0B5DC971F303AULL, 667, 220 },
+        { 0xA8D9D1535CE3B396ULL, 694, 228 },
+        { 0xFB9B7CD9A4A7443CULL, 720, 236 },
+        { 0xBB764C4CA7A44410ULL, 747, 244 },
+        { 0x8BAB8EEFB6409C1AULL, 774, 252 },
+        { 0xD01FEF10A657842CULL, 800, 260 },
+        { 0x9B10A4E5E9913129ULL, 827, 268 },
+        { 0xE7109BFBA19C0C9DULL, 853, 276 },
+        { 0xAC2820D9623BF429ULL, 880, 284 },
+        { 0x80444B5E7AA7CF85ULL, 907, 292 },
+        { 0xBF21E44003ACDD2DULL, 933, 300 },
+        { 0x8E679C2F5E44FF8FULL, 960, 308 },
+        { 0xD433179D9C8CB841ULL, 986, 316 },
+        { 0x9E19DB92B4E31BA9ULL, 1013, 324 },
+    };
+
+    const int cachedPowersMinDecExp = -300;
+    const int cachedPowersDecStep = 8;
+
+    // Window of the binary exponent of the scaled value, digits are generated with 32 bit arithmetic
+    const int alpha = -60;
+
+    // Cached power c with alpha <= e + c.e + 64 <= gamma (-32)
+    const CachedPower& cachedPowerFor(int e)
+    {
+        const int f = alpha - e - 1;
+        const int k = (f * 78913) / (1 << 18) + int(f > 0); // ceil(f * log10(2))
+        const int index = (-cachedPowersMinDecExp + k + (cachedPowersDecStep - 1)) / cachedPowersDecStep;
+        return cachedPowers[index];
+    }
+
+    int largestPow10(quint32 n, quint32 *pow10)
+    {
+        static const quint32 powers[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+        int digits = 10;
+        while (digits > 1 && n < powers[digits - 1])
+            digits--;
+        *pow10 = powers[digits - 1];
+        return digits;
+    }
+
+    // Moves the last digit towards the value while the result stays within the interval
+    void roundWeed(char *buf, int len, quint64 dist, quint64 delta, quint64 rest, quint64 tenK)
+    {
+        while (rest < dist && delta - rest >= tenK && (rest + tenK < dist || dist - rest > rest + tenK - dist))
+        {
+            buf[len - 1]--;
+            rest += tenK;
+        }
+    }
+
+    void generateDigits(char *buf, int *len, int *decimalExponent, const DiyFp &mMinus, const DiyFp &w, const DiyFp &mPlus)
+    {
+        quint64 delta = DiyFp::sub(mPlus, mMinus).f;
+        quint64 dist = DiyFp::sub(mPlus, w).f;
+
+        const DiyFp one(quint64(1) << -mPlus.e, mPlus.e);
+
+        quint32 p1 = quint32(mPlus.f >> -one.e);   // Integral part
+        quint64 p2 = mPlus.f & (one.f - 1);         // Fractional part
+
+        quint32 pow10;
+        int n = largestPow10(p1, &pow10);
+
+        while (n > 0)
+        {
+            buf[(*len)++] = char('0' + p1 / pow10);
+            p1 %= pow10;
+            n--;
+
+            const quint64 rest = (quint64(p1) << -one.e) + p2;
+            if (rest <= delta)
+            {
+                *decimalExponent += n;
+                roundWeed(buf, *len, dist, delta, rest, quint64(pow10) << -one.e);
+                return;
+            }
+
+            pow10 /= 10;
+        }
+
+        int m = 0;
+        forever
+        {
+            p2 *= 10;
+            buf[(*len)++] = char('0' + (p2 >> -one.e));
+            p2 &= one.f - 1;
+            m++;
+
+            delta *= 10;
+            dist *= 10;
+            if (p2 <= delta)
+                break;
+        }
+
+        *decimalExponent -= m;
+        roundWeed(buf, *len, dist, delta, p2, one.f);
+    }
+
+    // Digits and exponent of value = digits * 10^decimalExponent
+    void grisu2(char *buf, int *len, int *decimalExponent, const Boundaries &b)
+    {
+        const CachedPower &cached = cachedPowerFor(b.plus.e);
+        const DiyFp c(cached.f, cached.e);
+
+        const DiyFp w = DiyFp::mul(b.w, c);
+        const DiyFp wMinus = DiyFp::mul(b.minus, c);
+        const DiyFp wPlus = DiyFp::mul(b.plus, c);
+
+        // Shrink the interval by one unit to absorb the multiplication errors
+        const DiyFp mMinus(wMinus.f + 1, wMinus.e);
+        const DiyFp mPlus(wPlus.f - 1, wPlus.e);
+
+        *len = 0;
+        *decimalExponent = -cached.k;
+        generateDigits(buf, len, decimalExponent, mMinus, w, mPlus);
+    }
+
+    char* appendExponent(char *buf, int e)
+    {
+        if (e < 0)
+        {
+            *buf++ = '-';
+            e = -e;
+        }
+        else
+        {
+            *buf++ = '+';
+        }
+
+        if (e >= 100)
+        {
+            *buf++ = char('0' + e / 100);
+            e %= 100;
+            *buf++ = char('0' + e / 10);
+        }
+        else if (e >= 10)
+        {
+            *buf++ = char('0' + e / 10);
+        }
+        *buf++ = char('0' + e % 10);
+        return buf;
+    }
+
+    // Formats the digits in buf[0, len) * 10^decimalExponent, plain notation for exponents in [-5, 15]
+    char* formatDigits(char *buf, int len, int decimalExponent)
+    {
+        const int k = len;
+        const int n = len + decimalExponent; // Position of the decimal point
+
+        if (k <= n && n <= 15)
+        {
+            // digits[000]
+            std::memset(buf + k, '0', size_t(n - k));
+            return buf + n;
+        }
+
+        if (0 < n && n <= 15)
+        {
+            // dig.its
+            std::memmove(buf + n + 1, buf + n, size_t(k - n));
+            buf[n] = '.';
+            return buf + k + 1;
+        }
+
+        if (-5 < n && n <= 0)
+        {
+            // 0.[000]digits
+            std::memmove(buf + 2 - n, buf, size_t(k));
+            buf[0] = '0';
+            buf[1] = '.';
+            std::memset(buf + 2, '0', size_t(-n));
+            return buf + 2 - n + k;
+        }
+
+        if (k == 1)
+        {
+            // de+x
+            buf += 1;
+        }
+        else
+        {
+            // d.igitse+x
+            std::memmove(buf + 2, buf + 1, size_t(k - 1));
+            buf[1] = '.';
+            buf += k + 1;
+        }
+
+        *buf++ = 'e';
+        return appendExponent(buf, n - 1);
+    }
+
+    template <int Precision, int MaxExponent>
+    char* formatShortestBits(char *buf, quint64 bits, bool negative, bool zero)
+    {
+        if (negative)
+            *buf++ = '-';
+
+        if (zero)
+        {
+            *buf++ = '0';
+            return buf;
+        }
+
+        int len, decimalExponent;
+        grisu2(buf, &len, &decimalExponent, computeBoundaries<Precision, MaxExponent>(bits));
+        return formatDigits(buf, len, decimalExponent);
+    }
+
+    // Exact powers of ten
+    const double exactPowers[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    // 2^53, integers up to here are exact doubles
+    const double maxExactInteger = 9007199254740992.0;
+}
+
+char* number::formatShortest(char *buf, double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const bool negative = (bits >> 63) != 0;
+    bits &= ~(quint64(1) << 63);
+    return formatShortestBits<53, 1024>(buf, bits, negative, bits == 0);
+}
+
+char* number::formatShortest(char *buf, float value)
+{
+    quint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const bool negative = (bits >> 31) != 0;
+    bits &= ~(quint32(1) << 31);
+    return formatShortestBits<24, 128>(buf, bits, negative, bits == 0);
+}
+
+char* number::formatFixed(char *buf, double value, int precision)
+{
+    precision = qBound(0, precision, MaxPrecision);
+
+    const double scaled = value * exactPowers[precision];
+    if (!(std::abs(scaled) < maxExactInteger))
+        return formatShortest(buf, value); // No fractional digits left at this magnitude
+
+    const qint64 n = std::llround(scaled);
+    quint64 u = n < 0 ? 0 - quint64(n) : quint64(n);
+
+    // Digits from the back, the trailing fractional zeros are dropped
+    char digits[24];
+    char *p = digits + sizeof(digits);
+    int fraction = precision;
+    while (fraction > 0 && u % 10 == 0)
+    {
+        u /= 10;
+        fraction--;
+    }
+    for (int i = 0; i < fraction; i++)
+    {
+        *--p = char('0' + u % 10);
+        u /= 10;
+    }
+    if (fraction > 0)
+        *--p = '.';
+    do
+    {
+        *--p = char('0' + u % 10);
+        u /= 10;
+    }
+    while (u);
+    if (n < 0)
+        *--p = '-';
+
+    const int len = int(digits + sizeof(digits) - p);
+    std::memcpy(buf, p, size_t(len));
+    return buf + len;
+}
+
+double number::round(double value, int precision)
+{
+    precision = qBound(0, precision, MaxPrecision);
+
+    const double scaled = value * exactPowers[precision];
+    if (!(std::abs(scaled) < maxExactInteger))
+        return value;
+    return double(std::llround(scaled)) / exactPowers[precision];
+}
+
+bool number::isExactInteger(double value)
+{
+    // -0.0 compares equal to 0 but would lose its sign as an integer
+    return std::abs(value) < maxExactInteger && value == double(qint64(value)) && !(value == 0 && std::signbit(value));
+}
+
+
+//
+// Parsing, the Clinger fast path covers the numbers with up to 15 significant digits
+// and small exponents. The others are converted by Qt.
+//
+
+bool number::parse(const char *begin, const char *end, double *value)
+{
+    const char *p = begin;
+
+    const bool negative = p < end && *p == '-';
+    if (negative)
+        p++;
+
+    // Integral part, no leading zeros
+    if (p == end || *p < '0' || *p > '9')
+        return false;
+
+    quint64 mantissa = 0;
+    int digits = 0;         // Significant digits in mantissa
+    int exponent = 0;       // Decimal exponent of mantissa
+    bool truncated = false;
+
+    if (*p == '0')
+    {
+        p++;
+    }
+    else
+    {
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + quint64(*p - '0');
+                digits++;
+            }
+            else
+            {
+                exponent++;
+                truncated |= *p != '0';
+            }
+        }
+    }
+
+    // Fraction
+    if (p < end && *p == '.')
+    {
+        p++;
+        if (p == end || *p < '0' || *p > '9')
+            return false;
+
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            if (mantissa == 0 && *p == '0')
+            {
+                exponent--; // Leading zeros are not significant
+            }
+            else if (digits < 19)
+            {
+                mantissa = mantissa * 10 + quint64(*p - '0');
+                digits++;
+                exponent--;
+            }
+            else
+            {
+                truncated |= *p != '0';
+            }
+        }
+    }
+
+    // Exponent
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        bool negativeExp = false;
+        if (p < end && (*p == '+' || *p == '-'))
+            negativeExp = *p++ == '-';
+        if (p == end || *p < '0' || *p > '9')
+            return false;
+
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            if (e < 100000)
+                e = e * 10 + (*p - '0');
+        exponent += negativeExp ? -e : e;
+    }
+
+    if (p != end)
+        return false;
+
+    if (!truncated && mantissa <= quint64(maxExactInteger))
+    {
+        double d = double(mantissa);
+        bool exact = true;
+
+        if (mantissa == 0)
+            d = 0;
+        else if (exponent < 0 && exponent >= -22)
+            d /= exactPowers[-exponent];
+        else if (exponent >= 0 && exponent <= 22)
+            d *= exactPowers[exponent];
+        else if (exponent > 22 && exponent <= 22 + 15 && d * exactPowers[exponent - 22] <= maxExactInteger)
+            d = (d * exactPowers[exponent - 22]) * exactPowers[22]; // The first product is an exact integer
+        else
+            exact = false;
+
+        if (exact)
+        {
+            *value = negative ? -d : d;
+            return true;
+        }
+    }
+
+    bool ok = false;
+    *value = QByteArray::fromRawData(begin, int(end - begin)).toDouble(&ok);
+    return ok;
+}
@@ -0,0 +1,81 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+//
+// Private JenSON header, not part of the public API.
+//
+
+#ifndef JENSON_NUMBER_H
+#define JENSON_NUMBER_H
+
+#include <cstring>
+#include <QtGlobal>
+
+namespace jenson
+{
+    //
+    // Number text codec of the JsonWriter and JsonReader.
+    //
+
+    namespace number
+    {
+        // Size of the buffers passed to the format functions
+        const int BufferSize = 40;
+
+        // False for NaN and +-Inf, tested on the IEEE exponent bits because -ffast-math (Release builds)
+        // lets the compiler fold std::isfinite() to true
+        inline bool isFinite(double value)
+        {
+            quint64 bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return (bits & Q_UINT64_C(0x7FF0000000000000)) != Q_UINT64_C(0x7FF0000000000000);
+        }
+        inline bool isFinite(float value)
+        {
+            quint32 bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return (bits & 0x7F800000u) != 0x7F800000u;
+        }
+
+        // Writes the shortest representation that reads back as the same value (Grisu2),
+        // returns the end of the written text. Non-finite values are not handled.
+        char* formatShortest(char *buf, double value);
+        char* formatShortest(char *buf, float value);
+
+        // Writes value rounded to precision decimal places, without trailing zeros
+        char* formatFixed(char *buf, double value, int precision);
+
+        // Rounds value to precision decimal places
+        double round(double value, int precision);
+
+        // True if value is an integer below 2^53 in magnitude, false for -0.0.
+        // Not inline, the sign test must not be compiled with -ffast-math.
+        bool isExactInteger(double value);
+
+        // Parses a Json number spanning [begin, end), returns false if the text is not a Json number
+        bool parse(const char *begin, const char *end, double *value);
+
+        // Largest supported number of decimal places
+        const int MaxPrecision = 15;
+    }
+}
+
+#endif // JENSON_NUMBER_H
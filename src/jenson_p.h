@@ -0,0 +1,366 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+//
+// Private JenSON header, not part of the public API.
+//
+
+#ifndef JENSON_P_H
+#define JENSON_P_H
+
+#include <functional>
+#include <QAtomicInt>
+#include <QHash>
+#include <QPointer>
+#include <QReadWriteLock>
+#include <QVector>
+#include <QMetaMethod>
+#include "jenson.h"
+
+// AllocationScope counters, compiled in with -DAllocationStats=ON
+#ifdef JENSON_ALLOCATION_STATS
+#define JENSON_STATS_CLASS(META) jenson::AllocationScope::Class jensonStatsClass(META)
+#define JENSON_STATS_COUNT(COUNTER) jenson::AllocationScope::record(&jenson::AllocationStats::COUNTER)
+#else
+#define JENSON_STATS_CLASS(META)
+#define JENSON_STATS_COUNT(COUNTER)
+#endif
+
+namespace jenson
+{
+    //
+    // Compiled (de)serialization plan, built once per QMetaObject
+    //
+
+    // Packed numeric array property types
+    enum ArrayType
+    {
+        NoArray,
+        DoubleArray,    // QVector<double>
+        FloatArray,     // QVector<float>
+        IntArray        // QVector<int>
+    };
+
+    struct PropertyPlan
+    {
+        QMetaProperty property;
+        QString key;                                    // Json key (the property name)
+        QVariant::Type type;
+        QString className;                              // Property type name without '*'
+        const QMetaObject *nestedMeta;                  // Registered class of a nested object, or nullptr
+        const JenSON::ICustomSerializer *serializer;    // Custom serializer for className, or nullptr
+        const IField *field;                            // Typed accessor from JENSON_FIELDS, or nullptr
+        QMetaMethod lazyGet;                            // JENSON_LAZY_PROPERTY Json accessors, invalid otherwise
+        QMetaMethod lazySet;
+        QMetaMethod lazySetRaw;                         // Raw Json variant of lazySet, used by the streaming reader
+        QMetaMethod lazyError;                          // Why the getter returned nullptr, empty otherwise
+        ArrayType array;                                // Written as a plain number array if not NoArray
+        const IObjectContainer *container;              // QList/QVector of nestedMeta pointers, or nullptr
+        bool columnar;                                  // JENSON_COLUMNAR container
+        int precision;                                  // JENSON_PRECISION decimal places, -1 for the shortest representation
+    };
+
+    struct Registry;
+
+    struct ClassPlan
+    {
+        const QMetaObject *metaObject;
+        JenSON::TypeHandle handle;          // -1 if the class is not registered
+        QString className;
+        QString serialName;
+        const JenSON::ICustomSerializer *serializer;
+        QMetaMethod onDeserialized;
+
+        // The first property objectName is skipped
+        QVector<PropertyPlan> readable;
+        QVector<PropertyPlan> writable;
+        QHash<QString, int> writableIndex;  // Json key to index in writable
+
+        // Returns -1 if key is not a writable property
+        int indexOfWritable(const QString &key) const { return writableIndex.value(key, -1); }
+
+        // Returns the plan from the current registry, builds it on first use
+        static const ClassPlan* get(const QMetaObject *metaObject);
+        // Returns nullptr if className is not registered
+        static const ClassPlan* get(const QString &className);
+        // Returns the plan of a registered type from the given snapshot
+        static const ClassPlan* get(const Registry *reg, JenSON::TypeHandle handle);
+    };
+
+
+    //
+    // Registry snapshot (jenson_registry.cpp)
+    // Published snapshots are never modified and only freed at exit,
+    // so a loaded snapshot (and its plans) stays valid without locking.
+    //
+
+    struct TypeEntry
+    {
+        QString className;
+        QString serialName;
+        const QObject *prototype;
+        const JenSON::ICustomSerializer *serializer;
+        const FieldList *fields;    // JENSON_FIELDS of the class, or nullptr
+        const ObjectContainers *containers;
+    };
+
+    struct Registry
+    {
+        // Registered types, indexed by TypeHandle. Handles are never reused or reordered.
+        QVector<TypeEntry> types;
+        QHash<QString, int> classIndex;
+        QHash<QString, int> serialIndex;
+        QHash<const QMetaObject*, int> metaIndex;
+
+        // Ordered maps of the public getters
+        QMap<QString, const QObject*> typeMap;
+        QMap<QString, const JenSON::ICustomSerializer*> serializerMap;
+        nm_type nameMap;
+
+        // Fields generated by jenson-gen (by class name), used for classes without JENSON_FIELDS
+        QHash<QString, const FieldList*> generatedFields;
+        bool generatedFieldsEnabled = true;
+
+        // Plans of the registered types (by handle), carried over from the previous snapshot while valid.
+        // Built when the registry is frozen, nullptr before that until built on demand.
+        QVector<const ClassPlan*> plans;
+
+        // Plans built on demand (before the freeze or for unregistered classes)
+        mutable QReadWriteLock lazyLock;
+        mutable QHash<const QMetaObject*, ClassPlan*> lazyPlans;
+
+        Registry() = default;
+        ~Registry(); // Deletes the lazy plans
+
+        // Returns the current snapshot, wait-free once frozen. Publishes pending registrations first.
+        static const Registry* current();
+
+        int handleOf(const QMetaObject *metaObject) const { return metaIndex.value(metaObject, -1); }
+        int handleOfClass(const QString &className) const { return classIndex.value(className, -1); }
+        int handleOfSerialName(const QString &serialName) const { return serialIndex.value(serialName, -1); }
+        const TypeEntry* entry(const QString &className) const;
+
+        // JENSON_FIELDS of the class, or its enabled generated fields
+        const FieldList* fieldsOf(const TypeEntry *type) const;
+
+        void add(const QObject *prototype, const QString &serialName, const JenSON::ICustomSerializer *serializer,
+                 const FieldList *fields, const ObjectContainers *containers);
+        ClassPlan* buildPlan(const QMetaObject *metaObject) const;
+    };
+
+    // Resolves the key of a wrapped Json object (serial name, or class name if none is registered)
+    // to the plan of a registered type, returns nullptr and appends to errorMsg otherwise
+    const ClassPlan* resolveSerialName(const QString &serialName, QString *errorMsg);
+
+
+    //
+    // Serialization building blocks (jenson.cpp)
+    //
+
+    // Serializes the properties of qObj (without serial name wrapper)
+    QJsonValue serializeObject(const QObject *qObj, const ClassPlan *plan);
+
+    // Returns false if the property is skipped (invalid value or null object)
+    bool serializeProperty(const QObject *qObj, const PropertyPlan &prop, QJsonValue *value);
+
+    // Reads a QObject pointer property, nullptr if not set or not a QObject
+    QObject* nestedObject(const QObject *qObj, const PropertyPlan &prop);
+
+    // Conversions of QVector<double/float/int> properties to and from Json number arrays
+    QJsonValue arrayToJson(const QVariant &var, ArrayType array);
+    bool arrayFromJson(const QJsonValue &value, ArrayType array, QVariant *var);
+
+    // True if the typed container is written as columns, see JENSON_COLUMNAR
+    bool writesColumns(const PropertyPlan &prop, const ClassPlan *plan, const QVariant &container);
+
+    // Json of an unmaterialized lazy property, undefined otherwise
+    QJsonValue lazyJson(const QObject *qObj, const PropertyPlan &prop);
+
+
+    //
+    // Deserialization building blocks shared by the DOM and streaming paths (jenson.cpp)
+    //
+
+    // Creates a new instance, throws if the default ctor is not invokable
+    sptr<QObject> newInstance(const ClassPlan *plan);
+
+    // Writes value (possibly undefined) to the property, returns false if target failed to deserialize
+    bool deserializeProperty(QObject *target, const PropertyPlan &prop, const QJsonValue &value, QString *errorMsg);
+
+    // Resets the property after a failed write, returns false if the property is not resettable
+    bool handleWriteFailure(QObject *target, const PropertyPlan &prop, const QString &className, QString *errorMsg);
+
+    // Invokes onDeserialized() if available
+    void finishObject(QObject *obj, const ClassPlan *plan);
+
+
+    //
+    // Threading (jenson_batch.cpp)
+    //
+
+    // Runs fn(i) for i in [0, count) on the global QThreadPool and the calling thread,
+    // rethrows the first exception after all items are processed
+    void parallelFor(int count, const std::function<void(int)> &fn);
+
+    // JenSON::setParallelThreshold(), 0 if deserializeClass runs on the calling thread only
+    extern QAtomicInt parallelMinValues;
+
+    // True if count sibling values are enough to split them across the pool
+    inline bool runsParallel(int count)
+    {
+        int minValues = parallelMinValues.loadAcquire();
+        return minValues > 0 && count >= minValues;
+    }
+
+    // Builds results[i] = build(i) with parallelFor, object graphs built on a worker thread are moved to
+    // the calling thread and recorded in its CreatedObjects scope, so parents can be set after the join
+    void parallelBuild(int count, const std::function<sptr<QObject>(int)> &build, std::vector<sptr<QObject>> *results);
+
+    // Records the objects created by newInstance on the current thread while in scope,
+    // to move object graphs built on a worker thread (including unparented list items)
+    class CreatedObjects
+    {
+    private:
+        QVector<QPointer<QObject>> _objects;
+        CreatedObjects *_previous;
+
+    public:
+        CreatedObjects();
+        ~CreatedObjects();
+
+        static void record(QObject *obj);
+
+        // Moves all recorded objects without a parent (children follow their parent)
+        void moveToThread(QThread *thread);
+    };
+
+
+    //
+    // Asynchronous methods (jenson_async.cpp)
+    //
+
+    class AbstractReader;
+    class AbstractWriter;
+
+    // Progress and cancellation of the asynchronous method running on the current thread while in scope
+    class AsyncProgress
+    {
+    private:
+        QFutureInterfaceBase *_future;
+        AsyncProgress *_previous;
+        int _shift;         // Progress values are ints, large inputs are reported in 2^_shift bytes
+        qint64 _step;       // Bytes between progress reports
+        qint64 _next;
+
+        void report(qint64 offset);
+
+    public:
+        struct Canceled {};
+
+        // size is the input size in bytes, 0 if unknown
+        AsyncProgress(QFutureInterfaceBase *future, qint64 size);
+        ~AsyncProgress();
+
+        // Called per (de)serialized object, throws Canceled if the future is canceled
+        static void update(const AbstractReader *reader);
+        static void update(const AbstractWriter *writer);
+    };
+
+    class RecordingWriter;
+
+    // Streaming serialization of a root object, and the encoding of a recorded one (jenson_stream.cpp).
+    // serializeAsync records on the calling thread and encodes the recording on the pool.
+    void writeRoot(AbstractWriter *writer, const QObject *qObj);
+    void writeRecording(const RecordingWriter *recording, QByteArray *data, JenSON::Format format);
+
+
+    //
+    // Timing (jenson_metrics.cpp)
+    //
+
+    enum TimingFlag
+    {
+        TimingStats = 1,
+        TimingTrace = 2
+    };
+    extern QAtomicInt timingFlags;
+
+    // Times the (de)serialization of one metaObject instance while in scope, for JenSON::stats()
+    // and the Chrome trace. The bytes are the offset difference of the reader or writer, if given.
+    class Timing
+    {
+    private:
+        const QMetaObject *_metaObject;     // nullptr while disabled
+        OperationStats ClassStats::*_operation;
+        const AbstractReader *_reader;
+        const AbstractWriter *_writer;
+        Timing *_parent;
+        qint64 _start;
+        qint64 _offset;
+        qint64 _childNs;
+        int _flags;
+
+        void begin(const QMetaObject *metaObject, OperationStats ClassStats::*operation,
+                   const AbstractReader *reader, const AbstractWriter *writer, int flags);
+        void end();
+
+        Timing(const Timing&) = delete;
+        Timing& operator=(const Timing&) = delete;
+
+        friend class ParallelTiming;
+
+    public:
+        Timing(const QMetaObject *metaObject, OperationStats ClassStats::*operation,
+               const AbstractReader *reader = nullptr, const AbstractWriter *writer = nullptr)
+            : _metaObject(nullptr)
+        {
+            int flags = timingFlags.loadAcquire();
+            if (Q_UNLIKELY(flags != 0))
+                begin(metaObject, operation, reader, writer, flags);
+        }
+
+        ~Timing()
+        {
+            if (Q_UNLIKELY(_metaObject != nullptr))
+                end();
+        }
+    };
+
+    // Counts a parallelFor section as nested time of the innermost Timing of the calling thread,
+    // the objects built on the worker threads are nested in it but time themselves on their own thread
+    class ParallelTiming
+    {
+    private:
+        Timing *_timing;    // nullptr while disabled
+        qint64 _start;
+        qint64 _childNs;
+
+        ParallelTiming(const ParallelTiming&) = delete;
+        ParallelTiming& operator=(const ParallelTiming&) = delete;
+
+    public:
+        ParallelTiming();
+        ~ParallelTiming();
+    };
+}
+
+#endif // JENSON_P_H
@@ -0,0 +1,173 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson_p.h"
+#include "jenson_number.h"
+
+using namespace jenson;
+
+
+//
+// Plan building
+//
+
+ClassPlan* Registry::buildPlan(const QMetaObject *metaObject) const
+{
+    ClassPlan *plan = new ClassPlan();
+    plan->metaObject = metaObject;
+    plan->className = metaObject->className();
+
+    const TypeEntry *type = entry(plan->className);
+    plan->handle = type ? handleOfClass(plan->className) : -1;
+    plan->serialName = type ? type->serialName : plan->className;
+    plan->serializer = type ? type->serializer : nullptr;
+    const FieldList *fields = fieldsOf(type);
+
+    int idx = metaObject->indexOfMethod("onDeserialized()");
+    if (idx >= 0) plan->onDeserialized = metaObject->method(idx);
+
+    // The first property objectName is skipped
+    for (int i = 1; i < metaObject->propertyCount(); i++)
+    {
+        QMetaProperty mp = metaObject->property(i);
+
+        PropertyPlan prop;
+        prop.property = mp;
+        prop.key = mp.name();
+        prop.type = mp.type();
+        prop.className = mp.typeName();
+        prop.className.remove('*'); // Properties can be pointer types
+
+        const TypeEntry *nested = entry(prop.className);
+        prop.nestedMeta = nested ? nested->prototype->metaObject() : nullptr;
+        prop.serializer = nested ? nested->serializer : nullptr;
+        prop.field = fields ? fields->find(prop.key) : nullptr;
+
+        // Typed containers of a registered class, QList<T*> or QVector<T*>
+        prop.container = nullptr;
+        const QByteArray typeName = mp.typeName();
+        const bool isList = typeName.startsWith("QList<");
+        if (!nested && (isList || typeName.startsWith("QVector<")) && typeName.endsWith("*>"))
+        {
+            const int begin = isList ? 6 : 8;
+            const TypeEntry *element = entry(QString::fromLatin1(typeName.mid(begin, typeName.size() - begin - 2)));
+            if (element && element->containers &&
+                mp.userType() == (isList ? element->containers->listType : element->containers->vectorType))
+            {
+                prop.container = isList ? element->containers->list : element->containers->vector;
+                prop.nestedMeta = element->prototype->metaObject();
+                prop.serializer = element->serializer;
+            }
+        }
+
+        if (mp.userType() == qMetaTypeId<QVector<double>>())
+            prop.array = DoubleArray;
+        else if (mp.userType() == qMetaTypeId<QVector<float>>())
+            prop.array = FloatArray;
+        else if (mp.userType() == qMetaTypeId<QVector<int>>())
+            prop.array = IntArray;
+        else
+            prop.array = NoArray;
+
+        prop.columnar = prop.container && metaObject->indexOfClassInfo(QByteArray("jenson.columnar.") + mp.name()) >= 0;
+
+        int precision = metaObject->indexOfClassInfo(QByteArray("jenson.precision.") + mp.name());
+        prop.precision = precision >= 0 ? qBound(0, QByteArray(metaObject->classInfo(precision).value()).toInt(), int(number::MaxPrecision)) : -1;
+
+        int lazyGet = metaObject->indexOfMethod(QByteArray("jensonLazy_") + mp.name() + "()");
+        int lazySet = metaObject->indexOfMethod(QByteArray("jensonLazy_") + mp.name() + "(QJsonValue)");
+        int lazySetRaw = metaObject->indexOfMethod(QByteArray("jensonLazy_") + mp.name() + "(QByteArray,int,int)");
+        int lazyError = metaObject->indexOfMethod(QByteArray("jensonLazyError_") + mp.name() + "()");
+        if (lazyGet >= 0 && lazySet >= 0)
+        {
+            prop.lazyGet = metaObject->method(lazyGet);
+            prop.lazySet = metaObject->method(lazySet);
+            if (lazySetRaw >= 0)
+                prop.lazySetRaw = metaObject->method(lazySetRaw);
+            if (lazyError >= 0)
+                prop.lazyError = metaObject->method(lazyError);
+        }
+
+        if (mp.isReadable())
+            plan->readable.append(prop);
+        if (mp.isWritable())
+        {
+            plan->writableIndex.insert(prop.key, plan->writable.count());
+            plan->writable.append(prop);
+        }
+    }
+
+    return plan;
+}
+
+
+//
+// ClassPlan static methods
+//
+
+static const ClassPlan* lazyPlan(const Registry *reg, const QMetaObject *metaObject)
+{
+    {
+        QReadLocker locker(&reg->lazyLock);
+        const ClassPlan *plan = reg->lazyPlans.value(metaObject, nullptr);
+        if (plan)
+            return plan;
+    }
+
+    ClassPlan *built = reg->buildPlan(metaObject);
+
+    QWriteLocker locker(&reg->lazyLock);
+    ClassPlan *&cached = reg->lazyPlans[metaObject];
+    if (cached)
+        delete built; // Built concurrently by another thread
+    else
+        cached = built;
+    return cached;
+}
+
+const ClassPlan* ClassPlan::get(const QMetaObject *metaObject)
+{
+    const Registry *reg = Registry::current();
+
+    // Registered types of a frozen registry, no locking
+    int handle = reg->handleOf(metaObject);
+    if (handle >= 0 && handle < reg->plans.count() && reg->plans.at(handle))
+        return reg->plans.at(handle);
+
+    return lazyPlan(reg, metaObject);
+}
+
+const ClassPlan* ClassPlan::get(const QString &className)
+{
+    const Registry *reg = Registry::current();
+    int handle = reg->handleOfClass(className);
+    if (handle < 0)
+        return nullptr;
+    return get(reg, handle);
+}
+
+const ClassPlan* ClassPlan::get(const Registry *reg, JenSON::TypeHandle handle)
+{
+    if (handle < reg->plans.count() && reg->plans.at(handle))
+        return reg->plans.at(handle);
+    return lazyPlan(reg, reg->types.at(handle).prototype->metaObject());
+}
@@ -0,0 +1,531 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson_reader.h"
+
+#include <QIODevice>
+#include "jenson_number.h"
+#include "jenson_scan.h"
+
+using namespace jenson;
+
+// Size of the chunks read from a device
+static const int DEVICE_CHUNK = 64 * 1024;
+
+// Distinct object keys shared per reader, later keys are decoded each time
+static const int MAX_INTERNED_KEYS = 4096;
+
+static void appendUtf8(QByteArray *out, uint ucs4)
+{
+    if (ucs4 < 0x80)
+    {
+        out->append(char(ucs4));
+    }
+    else if (ucs4 < 0x800)
+    {
+        out->append(char(0xc0 | (ucs4 >> 6)));
+        out->append(char(0x80 | (ucs4 & 0x3f)));
+    }
+    else if (ucs4 < 0x10000)
+    {
+        out->append(char(0xe0 | (ucs4 >> 12)));
+        out->append(char(0x80 | ((ucs4 >> 6) & 0x3f)));
+        out->append(char(0x80 | (ucs4 & 0x3f)));
+    }
+    else
+    {
+        out->append(char(0xf0 | (ucs4 >> 18)));
+        out->append(char(0x80 | ((ucs4 >> 12) & 0x3f)));
+        out->append(char(0x80 | ((ucs4 >> 6) & 0x3f)));
+        out->append(char(0x80 | (ucs4 & 0x3f)));
+    }
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+
+//
+// JsonReader
+//
+
+JsonReader::JsonReader(const QByteArray &json)
+    : _buf(json), _device(nullptr), _pos(0), _consumed(0), _rawStart(-1), _expect(ExpectValue)
+{
+}
+
+JsonReader::JsonReader(QIODevice *device)
+    : _device(device), _pos(0), _consumed(0), _rawStart(-1), _expect(ExpectValue)
+{
+}
+
+bool JsonReader::fill()
+{
+    if (!_device)
+        return false;
+
+    // Drop the consumed bytes, the current token starts at _pos
+    if (_pos > 0)
+    {
+        if (_rawStart >= 0)
+        {
+            _raw.append(_buf.constData() + _rawStart, _pos - _rawStart);
+            _rawStart = 0;
+        }
+        _buf.remove(0, _pos);
+        _consumed += _pos;
+        _pos = 0;
+    }
+
+    QByteArray chunk = _device->read(DEVICE_CHUNK);
+    if (chunk.isEmpty())
+        return false;
+
+    _buf.append(chunk);
+    return true;
+}
+
+bool JsonReader::available(int count)
+{
+    while (_pos + count > _buf.size())
+        if (!fill())
+            return false;
+    return true;
+}
+
+bool JsonReader::skipWhitespace()
+{
+    forever
+    {
+        if (_pos >= _buf.size() && !fill())
+            return false;
+
+        const char *data = _buf.constData();
+        _pos = int(scan::skipWhitespace(data + _pos, data + _buf.size()) - data);
+        if (_pos < _buf.size())
+            return true;
+    }
+}
+
+JsonReader::Token JsonReader::afterValue(Token token)
+{
+    _expect = _stack.isEmpty() ? ExpectEnd : ExpectCommaOrEnd;
+    _token = token;
+    return _token;
+}
+
+// Object keys repeat for every object of a class, equal keys share one QString
+QString JsonReader::internKey(const char *utf8, int len)
+{
+    QHash<QByteArray, QString>::const_iterator it = _keys.constFind(QByteArray::fromRawData(utf8, len));
+    if (it != _keys.constEnd())
+        return it.value();
+
+    QString key = QString::fromUtf8(utf8, len);
+    if (_keys.size() < MAX_INTERNED_KEYS)
+        _keys.insert(QByteArray(utf8, len), key);
+    return key;
+}
+
+bool JsonReader::parseString(QString *out, bool key)
+{
+    // _pos is at the opening quote, offsets are relative to _pos as fill() may move the buffer
+    int i = 1;
+    bool escaped = false;
+
+    forever
+    {
+        if (_pos + i >= _buf.size() && !fill())
+            return false;
+
+        // Skip the plain characters in bulk, stop at a quote, backslash or control character
+        const char *data = _buf.constData();
+        i = int(scan::findStringSpecial(data + _pos + i, data + _buf.size()) - data) - _pos;
+        if (_pos + i >= _buf.size())
+            continue;
+
+        const uchar c = static_cast<uchar>(data[_pos + i]);
+        if (c == '"')
+            break;
+        if (c < 0x20)
+            return false;
+
+        escaped = true;
+        i++; // The escaped character is never the closing quote
+        if (_pos + i >= _buf.size() && !fill())
+            return false;
+        i++;
+    }
+
+    const char *begin = _buf.constData() + _pos + 1;
+    const int len = i - 1;
+
+    if (!escaped)
+    {
+        *out = key ? internKey(begin, len) : QString::fromUtf8(begin, len);
+        _pos += i + 1;
+        return true;
+    }
+
+    QByteArray utf8;
+    utf8.reserve(len);
+    for (int j = 0; j < len; j++)
+    {
+        const char c = begin[j];
+        if (c != '\\')
+        {
+            utf8.append(c);
+            continue;
+        }
+
+        const char e = begin[++j];
+        switch (e)
+        {
+        case '"': utf8.append('"'); break;
+        case '\\': utf8.append('\\'); break;
+        case '/': utf8.append('/'); break;
+        case 'b': utf8.append('\b'); break;
+        case 'f': utf8.append('\f'); break;
+        case 'n': utf8.append('\n'); break;
+        case 'r': utf8.append('\r'); break;
+        case 't': utf8.append('\t'); break;
+        case 'u':
+        {
+            uint ucs4 = 0;
+            for (int k = 0; k < 4; k++)
+            {
+                const int h = (j + 1 < len) ? hexValue(begin[++j]) : -1;
+                if (h < 0)
+                    return false;
+                ucs4 = (ucs4 << 4) | uint(h);
+            }
+
+            // Combine surrogate pairs
+            if (ucs4 >= 0xd800 && ucs4 < 0xdc00 && j + 6 < len && begin[j + 1] == '\\' && begin[j + 2] == 'u')
+            {
+                uint low = 0;
+                bool valid = true;
+                for (int k = 0; k < 4; k++)
+                {
+                    const int h = hexValue(begin[j + 3 + k]);
+                    if (h < 0) valid = false;
+                    low = (low << 4) | uint(h);
+                }
+                if (valid && low >= 0xdc00 && low < 0xe000)
+                {
+                    ucs4 = 0x10000 + ((ucs4 - 0xd800) << 10) + (low - 0xdc00);
+                    j += 6;
+                }
+            }
+
+            appendUtf8(&utf8, ucs4);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+
+    *out = QString::fromUtf8(utf8);
+    _pos += i + 1;
+    return true;
+}
+
+bool JsonReader::parseNumber()
+{
+    int i = 0;
+
+    forever
+    {
+        if (_pos + i >= _buf.size() && !fill())
+            break;
+
+        const char c = _buf.at(_pos + i);
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')
+            i++;
+        else
+            break;
+    }
+
+    const char *begin = _buf.constData() + _pos;
+    _pos += i;
+    return number::parse(begin, begin + i, &_number);
+}
+
+bool JsonReader::parseLiteral(const char *literal, int len)
+{
+    if (!available(len) || qstrncmp(_buf.constData() + _pos, literal, len) != 0)
+        return false;
+    _pos += len;
+    return true;
+}
+
+// Moves _pos after the string at _pos without decoding it, the escapes are validated when it is parsed
+bool JsonReader::skipString()
+{
+    int i = 1;
+
+    forever
+    {
+        while (_pos + i >= _buf.size())
+            if (!fill())
+                return false;
+
+        const char *data = _buf.constData();
+        i = int(scan::findStringSpecial(data + _pos + i, data + _buf.size()) - data) - _pos;
+        if (_pos + i >= _buf.size())
+            continue;
+
+        const char c = data[_pos + i];
+        if (c == '"')
+            break;
+        i += (c == '\\') ? 2 : 1; // The escaped character is never the closing quote
+    }
+
+    _pos += i + 1;
+    return true;
+}
+
+JsonReader::Token JsonReader::parseValue(char c)
+{
+    switch (c)
+    {
+    case '{':
+        _pos++;
+        _stack.append('{');
+        _expect = ExpectKeyOrEnd;
+        _token = BeginObject;
+        return _token;
+
+    case '[':
+        _pos++;
+        _stack.append('[');
+        _expect = ExpectValueOrEnd;
+        _token = BeginArray;
+        return _token;
+
+    case '"':
+        if (!parseString(&_text))
+            return fail("Invalid string");
+        return afterValue(String);
+
+    case 't':
+        if (!parseLiteral("true", 4))
+            return fail("Invalid literal");
+        _bool = true;
+        return afterValue(Bool);
+
+    case 'f':
+        if (!parseLiteral("false", 5))
+            return fail("Invalid literal");
+        _bool = false;
+        return afterValue(Bool);
+
+    case 'n':
+        if (!parseLiteral("null", 4))
+            return fail("Invalid literal");
+        return afterValue(Null);
+
+    default:
+        if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            if (!parseNumber())
+                return fail("Invalid number");
+            return afterValue(Number);
+        }
+        return fail("Unexpected character");
+    }
+}
+
+bool JsonReader::nextNumber(double *value)
+{
+    // Fast path for number arrays, the separators and numbers are parsed without next()
+    if (_token != Error && !_stack.isEmpty() && _stack.last() == '[' && skipWhitespace())
+    {
+        if (_expect == ExpectCommaOrEnd && _buf.at(_pos) == ',')
+        {
+            _pos++;
+            _expect = ExpectValue;
+            if (!skipWhitespace())
+                return AbstractReader::nextNumber(value); // Reports the error
+        }
+
+        const char c = _buf.at(_pos);
+        if ((_expect == ExpectValue || _expect == ExpectValueOrEnd) && (c == '-' || (c >= '0' && c <= '9')))
+        {
+            if (!parseNumber())
+            {
+                fail("Invalid number");
+                return false;
+            }
+            afterValue(Number);
+            *value = _number;
+            return true;
+        }
+    }
+
+    return AbstractReader::nextNumber(value);
+}
+
+JsonReader::Token JsonReader::next()
+{
+    if (_token == Error || _token == EndOfInput)
+        return _token;
+
+    forever
+    {
+        if (!skipWhitespace())
+        {
+            if (_expect == ExpectEnd)
+            {
+                _token = EndOfInput;
+                return _token;
+            }
+            return fail("Unexpected end of input");
+        }
+
+        const char c = _buf.at(_pos);
+
+        switch (_expect)
+        {
+        case ExpectValueOrEnd:
+            if (c == ']')
+            {
+                _pos++;
+                _stack.removeLast();
+                return afterValue(EndArray);
+            }
+            return parseValue(c);
+
+        case ExpectValue:
+            return parseValue(c);
+
+        case ExpectKeyOrEnd:
+            if (c == '}')
+            {
+                _pos++;
+                _stack.removeLast();
+                return afterValue(EndObject);
+            }
+            // fall through
+        case ExpectKey:
+            if (c != '"' || !parseString(&_text, true))
+                return fail("Expected object key");
+            if (!skipWhitespace() || _buf.at(_pos) != ':')
+                return fail("Expected ':'");
+            _pos++;
+            _expect = ExpectValue;
+            _token = Key;
+            return _token;
+
+        case ExpectCommaOrEnd:
+            if (c == ',')
+            {
+                _pos++;
+                _expect = (_stack.last() == '{') ? ExpectKey : ExpectValue;
+                continue;
+            }
+            if (c == '}' && _stack.last() == '{')
+            {
+                _pos++;
+                _stack.removeLast();
+                return afterValue(EndObject);
+            }
+            if (c == ']' && _stack.last() == '[')
+            {
+                _pos++;
+                _stack.removeLast();
+                return afterValue(EndArray);
+            }
+            return fail("Expected ',' or end of container");
+
+        case ExpectEnd:
+            return fail("Unexpected data after the root value");
+        }
+    }
+}
+
+bool JsonReader::rawValue(QByteArray *source, int *offset, int *length)
+{
+    if (_token != BeginObject && _token != BeginArray)
+        return false;
+
+    // Only brackets outside of strings are counted, the value is tokenized when it is parsed
+    const Token end = (_token == BeginObject) ? EndObject : EndArray;
+    _rawStart = _pos - 1; // The opening bracket
+    _raw.clear();
+
+    int depth = 1;
+    while (depth > 0)
+    {
+        if (_pos >= _buf.size() && !fill())
+        {
+            _rawStart = -1;
+            fail("Unexpected end of input");
+            return false;
+        }
+
+        const char c = _buf.at(_pos);
+        if (c == '"')
+        {
+            if (!skipString())
+            {
+                _rawStart = -1;
+                fail("Invalid string");
+                return false;
+            }
+            continue;
+        }
+
+        _pos++;
+        if (c == '{' || c == '[')
+            depth++;
+        else if (c == '}' || c == ']')
+            depth--;
+    }
+
+    // Shares the input buffer, device input and borrowed buffers are copied
+    if (_device || _copyRaw)
+    {
+        _raw.append(_buf.constData() + _rawStart, _pos - _rawStart);
+        *source = _raw;
+        *offset = 0;
+        *length = _raw.size();
+        _raw = QByteArray();
+    }
+    else
+    {
+        *source = _buf;
+        *offset = _rawStart;
+        *length = _pos - _rawStart;
+    }
+    _rawStart = -1;
+
+    _stack.removeLast();
+    afterValue(end);
+    return true;
+}
@@ -0,0 +1,85 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+//
+// Private JenSON header, not part of the public API.
+//
+
+#ifndef JENSON_READER_H
+#define JENSON_READER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+#include "jenson_format.h"
+
+class QIODevice;
+
+namespace jenson
+{
+    //
+    // Forward-only Json tokenizer (pull parser).
+    // Reads from a QByteArray or in chunks from a QIODevice, no DOM is built.
+    //
+
+    class JsonReader : public AbstractReader
+    {
+    private:
+        enum Expect { ExpectValue, ExpectValueOrEnd, ExpectKey, ExpectKeyOrEnd, ExpectCommaOrEnd, ExpectEnd };
+
+        QByteArray _buf;
+        QIODevice *_device;
+        int _pos;               // Read position in _buf
+        qint64 _consumed;       // Bytes dropped from the front of _buf
+        int _rawStart;          // Start of the raw value in _buf while rawValue() copies it, -1 otherwise
+        QByteArray _raw;        // Raw value bytes fill() dropped from _buf
+
+        QVector<char> _stack;   // Open containers '{' or '['
+        Expect _expect;
+        QHash<QByteArray, QString> _keys;   // Decoded object keys by their UTF-8 bytes
+
+        QString internKey(const char *utf8, int len);
+
+        bool fill();
+        bool skipWhitespace();
+        bool available(int count);
+        bool parseString(QString *out, bool key = false);
+        bool skipString();
+        bool parseNumber();
+        bool parseLiteral(const char *literal, int len);
+        Token parseValue(char c);
+        Token afterValue(Token token);
+
+    protected:
+        virtual bool nextNumber(double *value) override;
+
+    public:
+        explicit JsonReader(const QByteArray &json);
+        explicit JsonReader(QIODevice *device);
+
+        virtual Token next() override;
+        virtual bool rawValue(QByteArray *source, int *offset, int *length) override;
+        virtual qint64 offset() const override { return _consumed + _pos; }
+    };
+}
+
+#endif // JENSON_READER_H
@@ -0,0 +1,371 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson.h"
+#include "jenson_p.h"
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QMutex>
+#include <QSet>
+
+using namespace jenson;
+
+
+//
+// Registry snapshots
+//
+
+namespace
+{
+    struct RegistryState
+    {
+        Registry pending;                       // Registrations, only touched under writeMutex, never handed out
+        QSet<QString> changed;                  // Class names registered or modified since the last publish
+        bool allChanged;                        // A setting changed that affects every plan
+        QAtomicInt dirty;                       // pending has not been published yet
+        Registry empty;                         // Published until the first registration is
+        QAtomicPointer<const Registry> current;
+        QAtomicInt frozen;
+        QMutex writeMutex;                      // Serializes registrations, publishing and freezing
+        QList<const Registry*> retired;         // Kept alive for readers of older snapshots, freed at exit
+        QList<const ClassPlan*> plans;          // Prebuilt plans, shared by consecutive snapshots, freed at exit
+
+        RegistryState() : allChanged(false), dirty(0), current(&empty), frozen(0) {}
+
+        ~RegistryState()
+        {
+            const Registry *reg = current.load();
+            if (reg != &empty)
+                delete reg;
+            qDeleteAll(retired);
+            qDeleteAll(plans);
+        }
+    };
+}
+
+static RegistryState& state()
+{
+    static RegistryState s;
+    return s;
+}
+
+// Copies the registrations, not the plans. The containers are implicitly shared until pending changes again.
+static Registry* copyRegistry(const Registry *reg)
+{
+    Registry *copy = new Registry();
+    copy->types = reg->types;
+    copy->classIndex = reg->classIndex;
+    copy->serialIndex = reg->serialIndex;
+    copy->metaIndex = reg->metaIndex;
+    copy->typeMap = reg->typeMap;
+    copy->serializerMap = reg->serializerMap;
+    copy->nameMap = reg->nameMap;
+    copy->generatedFields = reg->generatedFields;
+    copy->generatedFieldsEnabled = reg->generatedFieldsEnabled;
+    return copy;
+}
+
+// Class looked up for a property, the element class of typed containers
+static QString referencedClass(const PropertyPlan &prop)
+{
+    const QString &name = prop.className;
+    if (!name.endsWith('>'))
+        return name;
+    int begin = name.indexOf('<') + 1;
+    return name.mid(begin, name.size() - begin - 1);
+}
+
+// A plan is stale if its class or a class its properties refer to changed
+static bool isStale(const ClassPlan *plan, const QSet<QString> &changed)
+{
+    if (changed.contains(plan->className))
+        return true;
+    foreach (const PropertyPlan &prop, plan->readable)
+        if (changed.contains(referencedClass(prop)))
+            return true;
+    foreach (const PropertyPlan &prop, plan->writable)
+        if (changed.contains(referencedClass(prop)))
+            return true;
+    return false;
+}
+
+// Publishes the pending registrations as a new snapshot, call with writeMutex locked.
+// Plans that are still valid are carried over, the others are rebuilt if the registry is frozen
+// (so frozen lookups need no lock) or built on demand otherwise.
+static void publishLocked(RegistryState &s)
+{
+    const Registry *old = s.current.loadAcquire();
+    Registry *reg = copyRegistry(&s.pending);
+    const bool build = s.frozen.loadAcquire();
+
+    reg->plans.resize(reg->types.count());
+    for (int handle = 0; handle < reg->types.count(); handle++)
+    {
+        const ClassPlan *plan = handle < old->plans.count() ? old->plans.at(handle) : nullptr;
+        if (plan && (s.allChanged || isStale(plan, s.changed)))
+            plan = nullptr;
+
+        if (!plan && build)
+        {
+            ClassPlan *built = reg->buildPlan(reg->types.at(handle).prototype->metaObject());
+            built->handle = handle;
+            s.plans.append(built);
+            plan = built;
+        }
+        reg->plans[handle] = plan;
+    }
+
+    s.current.storeRelease(reg);
+    if (old != &s.empty)
+        s.retired.append(old);
+
+    s.changed.clear();
+    s.allChanged = false;
+    s.dirty.storeRelease(0);
+}
+
+Registry::~Registry()
+{
+    qDeleteAll(lazyPlans); // The prebuilt plans are owned by the registry state
+}
+
+const Registry* Registry::current()
+{
+    RegistryState &s = state();
+
+    // Registrations since the last lookup are published in one snapshot
+    if (s.dirty.loadAcquire())
+    {
+        QMutexLocker locker(&s.writeMutex);
+        if (s.dirty.loadAcquire())
+            publishLocked(s);
+    }
+
+    return s.current.loadAcquire();
+}
+
+const TypeEntry* Registry::entry(const QString &className) const
+{
+    int handle = handleOfClass(className);
+    return handle < 0 ? nullptr : &types.at(handle);
+}
+
+const FieldList* Registry::fieldsOf(const TypeEntry *type) const
+{
+    if (!type)
+        return nullptr;
+    if (type->fields || !generatedFieldsEnabled)
+        return type->fields;
+    return generatedFields.value(type->className);
+}
+
+void Registry::add(const QObject *prototype, const QString &serialName, const JenSON::ICustomSerializer *serializer,
+                   const FieldList *fields, const ObjectContainers *containers)
+{
+    QString className = prototype->metaObject()->className();
+
+    int handle = handleOfClass(className);
+    if (handle < 0)
+    {
+        TypeEntry type;
+        type.className = className;
+        type.serialName = className; // Until a unique serial name is assigned below
+        type.prototype = prototype;
+        type.serializer = nullptr;
+        type.fields = nullptr;
+        type.containers = nullptr;
+
+        handle = types.count();
+        types.append(type);
+        classIndex.insert(className, handle);
+    }
+
+    // Serial names are unique and assigned once, like the bimap insert
+    TypeEntry &type = types[handle];
+    if (nameMap.insert(nm_type::value_type(className, serialName)).second)
+    {
+        type.serialName = serialName;
+        serialIndex.insert(serialName, handle);
+    }
+
+    metaIndex.remove(type.prototype->metaObject());
+    type.prototype = prototype;
+    type.fields = fields;
+    type.containers = containers;
+    metaIndex.insert(prototype->metaObject(), handle);
+    typeMap[className] = prototype;
+
+    if (serializer)
+    {
+        type.serializer = serializer;
+        serializerMap[className] = serializer;
+    }
+}
+
+const ClassPlan* jenson::resolveSerialName(const QString &serialName, QString *errorMsg)
+{
+    const Registry *reg = Registry::current();
+
+    int handle = reg->handleOfSerialName(serialName);
+    if (handle < 0)
+        handle = reg->handleOfClass(serialName);
+
+    if (handle < 0)
+    {
+        if (errorMsg)
+            errorMsg->append("\n Class \"" + serialName + "\" is not registered for deserialization");
+        return nullptr;
+    }
+
+    return ClassPlan::get(reg, handle);
+}
+
+
+//
+// Registry static class methods
+//
+
+// Applies a modification to the pending registrations. Before the freeze they are published by the next
+// lookup, so static and plugin registrations are batched. Frozen lookups never lock, publish right away.
+static void modifyRegistry(const std::function<void(Registry*)> &modify)
+{
+    RegistryState &s = state();
+    QMutexLocker locker(&s.writeMutex);
+
+    modify(&s.pending);
+    s.dirty.storeRelease(1);
+
+    if (s.frozen.loadAcquire())
+        publishLocked(s);
+}
+
+void JenSON::registerClass(const QObject *prototype, const QString &serialName, const ICustomSerializer *serializer,
+                           const FieldList *fields, const ObjectContainers *containers)
+{
+    modifyRegistry([&](Registry *reg) {
+        reg->add(prototype, serialName, serializer, fields, containers);
+        state().changed.insert(prototype->metaObject()->className());
+    });
+}
+
+void JenSON::registerGeneratedFields(const QMetaObject *metaObject, const FieldList *fields)
+{
+    modifyRegistry([&](Registry *reg) {
+        reg->generatedFields.insert(metaObject->className(), fields);
+        state().changed.insert(metaObject->className());
+    });
+}
+
+void JenSON::setGeneratedFieldsEnabled(bool enabled)
+{
+    if (isGeneratedFieldsEnabled() == enabled)
+        return;
+
+    modifyRegistry([&](Registry *reg) {
+        reg->generatedFieldsEnabled = enabled;
+        state().allChanged = true;
+    });
+}
+
+bool JenSON::isGeneratedFieldsEnabled()
+{
+    return Registry::current()->generatedFieldsEnabled;
+}
+
+bool JenSON::hasGeneratedFields(TypeHandle handle)
+{
+    const Registry *reg = Registry::current();
+    if (handle < 0 || handle >= reg->types.count())
+        return false;
+    const TypeEntry &type = reg->types.at(handle);
+    return !type.fields && reg->generatedFields.contains(type.className);
+}
+
+void JenSON::freezeRegistry()
+{
+    RegistryState &s = state();
+    QMutexLocker locker(&s.writeMutex);
+
+    if (s.frozen.loadAcquire())
+        return;
+
+    // Builds the plans the last snapshot left to be built on demand
+    s.frozen.storeRelease(1);
+    publishLocked(s);
+}
+
+bool JenSON::isRegistryFrozen()
+{
+    return state().frozen.loadAcquire();
+}
+
+JenSON::TypeHandle JenSON::typeHandle(const QMetaObject *metaObject)
+{
+    return Registry::current()->handleOf(metaObject);
+}
+
+JenSON::TypeHandle JenSON::typeHandle(const QString &className)
+{
+    return Registry::current()->handleOfClass(className);
+}
+
+JenSON::TypeHandle JenSON::typeHandleOfSerialName(const QString &serialName)
+{
+    return Registry::current()->handleOfSerialName(serialName);
+}
+
+int JenSON::typeCount()
+{
+    return Registry::current()->types.count();
+}
+
+QString JenSON::className(TypeHandle handle)
+{
+    const Registry *reg = Registry::current();
+    if (handle < 0 || handle >= reg->types.count())
+        return QString();
+    return reg->types.at(handle).className;
+}
+
+QString JenSON::serialName(TypeHandle handle)
+{
+    const Registry *reg = Registry::current();
+    if (handle < 0 || handle >= reg->types.count())
+        return QString();
+    return reg->types.at(handle).serialName;
+}
+
+const QMap<QString, const QObject*>& JenSON::typeMap()
+{
+    return Registry::current()->typeMap;
+}
+
+const QMap<QString, const JenSON::ICustomSerializer*>& JenSON::serializerMap()
+{
+    return Registry::current()->serializerMap;
+}
+
+const nm_type& JenSON::nameMap()
+{
+    return Registry::current()->nameMap;
+}
@@ -0,0 +1,222 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+#include "jenson_scan.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define JENSON_SCAN_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JENSON_SCAN_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+using namespace jenson;
+
+namespace
+{
+    inline bool isWhitespace(unsigned char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+    inline bool isStringSpecial(unsigned char c) { return c == '"' || c == '\\' || c < 0x20; }
+
+    inline int firstBit(unsigned int mask)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctz(mask);
+#else
+        int i = 0;
+        while (!(mask & 1u)) { mask >>= 1; i++; }
+        return i;
+#endif
+    }
+
+
+    //
+    // Scalar
+    //
+
+    const char* skipWhitespaceScalar(const char *begin, const char *end)
+    {
+        while (begin < end && isWhitespace(static_cast<unsigned char>(*begin)))
+            begin++;
+        return begin;
+    }
+
+    const char* findStringSpecialScalar(const char *begin, const char *end)
+    {
+        while (begin < end && !isStringSpecial(static_cast<unsigned char>(*begin)))
+            begin++;
+        return begin;
+    }
+
+
+#ifdef JENSON_SCAN_SSE2
+    //
+    // SSE2, 16 bytes per step
+    //
+
+    const char* skipWhitespaceSse2(const char *begin, const char *end)
+    {
+        // Most whitespace runs are a single separator, don't pay for a vector load
+        if (begin < end && !isWhitespace(static_cast<unsigned char>(*begin)))
+            return begin;
+
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i tab = _mm_set1_epi8('\t');
+
+        for (; end - begin >= 16; begin += 16)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+            const __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, lf)),
+                                            _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+            const unsigned int other = ~unsigned(_mm_movemask_epi8(ws)) & 0xffffu;
+            if (other)
+                return begin + firstBit(other);
+        }
+
+        return skipWhitespaceScalar(begin, end);
+    }
+
+    const char* findStringSpecialSse2(const char *begin, const char *end)
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1f);
+
+        for (; end - begin >= 16; begin += 16)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+            // Unsigned v <= 0x1f as max(v, 0x1f) == 0x1f
+            const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                                 _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+            const unsigned int mask = unsigned(_mm_movemask_epi8(special));
+            if (mask)
+                return begin + firstBit(mask);
+        }
+
+        return findStringSpecialScalar(begin, end);
+    }
+#endif
+
+
+#ifdef JENSON_SCAN_AVX2
+    //
+    // AVX2, 32 bytes per step, only called after the runtime CPU check
+    //
+
+    __attribute__((target("avx2")))
+    const char* skipWhitespaceAvx2(const char *begin, const char *end)
+    {
+        if (begin < end && !isWhitespace(static_cast<unsigned char>(*begin)))
+            return begin;
+
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const __m256i cr = _mm256_set1_epi8('\r');
+        const __m256i tab = _mm256_set1_epi8('\t');
+
+        for (; end - begin >= 32; begin += 32)
+        {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+            const __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, lf)),
+                                               _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, tab)));
+            const unsigned int other = ~unsigned(_mm256_movemask_epi8(ws));
+            if (other)
+                return begin + firstBit(other);
+        }
+
+        return skipWhitespaceSse2(begin, end);
+    }
+
+    __attribute__((target("avx2")))
+    const char* findStringSpecialAvx2(const char *begin, const char *end)
+    {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i control = _mm256_set1_epi8(0x1f);
+
+        for (; end - begin >= 32; begin += 32)
+        {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+            const __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                                    _mm256_cmpeq_epi8(_mm256_max_epu8(v, control), control));
+            const unsigned int mask = unsigned(_mm256_movemask_epi8(special));
+            if (mask)
+                return begin + firstBit(mask);
+        }
+
+        return findStringSpecialSse2(begin, end);
+    }
+#endif
+
+
+    //
+    // Runtime dispatch
+    //
+
+    struct Kernels
+    {
+        const char* (*skipWhitespace)(const char*, const char*);
+        const char* (*findStringSpecial)(const char*, const char*);
+        const char *level;
+    };
+
+    Kernels selectKernels()
+    {
+#ifdef JENSON_SCAN_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            Kernels k = { skipWhitespaceAvx2, findStringSpecialAvx2, "avx2" };
+            return k;
+        }
+#endif
+#ifdef JENSON_SCAN_SSE2
+        Kernels k = { skipWhitespaceSse2, findStringSpecialSse2, "sse2" };
+#else
+        Kernels k = { skipWhitespaceScalar, findStringSpecialScalar, "scalar" };
+#endif
+        return k;
+    }
+
+    const Kernels& kernels()
+    {
+        static const Kernels k = selectKernels();
+        return k;
+    }
+}
+
+const char* scan::skipWhitespace(const char *begin, const char *end)
+{
+    return kernels().skipWhitespace(begin, end);
+}
+
+const char* scan::findStringSpecial(const char *begin, const char *end)
+{
+    return kernels().findStringSpecial(begin, end);
+}
+
+const char* scan::level()
+{
+    return kernels().level;
+}
@@ -0,0 +1,49 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+//
+// Private JenSON header, not part of the public API.
+//
+
+#ifndef JENSON_SCAN_H
+#define JENSON_SCAN_H
+
+namespace jenson
+{
+    //
+    // Byte scanning kernels used by the JsonReader.
+    // The SSE2/AVX2 or scalar implementation is selected once, at load time, from the host CPU.
+    //
+
+    namespace scan
+    {
+        // Returns the first byte in [begin, end) that is not Json whitespace, end if there is none
+        const char* skipWhitespace(const char *begin, const char *end);
+
+        // Returns the first '"', '\\' or control character in [begin, end), end if there is none
+        const char* findStringSpecial(const char *begin, const char *end);
+
+        // Name of the selected implementation: "avx2", "sse2" or "scalar"
+        const char* level();
+    }
+}
+
+#endif // JENSON_SCAN_H
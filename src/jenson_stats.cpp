@@ -0,0 +1,185 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+#include "jenson_stats.h"
+
+#include <QMetaObject>
+#include <QMutex>
+
+using namespace jenson;
+
+namespace
+{
+    thread_local AllocationScope *t_scope = nullptr;
+    thread_local AllocationStats *t_class = nullptr;   // Stats of the class being (de)serialized
+    thread_local bool t_busy = false;                   // Set while the scope itself allocates
+
+    // Serializes the scopes of worker threads that end into the same outer scope
+    QMutex& mergeMutex()
+    {
+        static QMutex mutex;
+        return mutex;
+    }
+
+    struct Busy
+    {
+        Busy() { t_busy = true; }
+        ~Busy() { t_busy = false; }
+    };
+}
+
+
+//
+// AllocationStats
+//
+
+AllocationStats& AllocationStats::operator+=(const AllocationStats &other)
+{
+    allocations += other.allocations;
+    allocatedBytes += other.allocatedBytes;
+    objects += other.objects;
+    variants += other.variants;
+    jsonValues += other.jsonValues;
+    return *this;
+}
+
+
+//
+// AllocationScope
+//
+
+AllocationScope::AllocationScope()
+    : _previous(t_scope), _outer(t_scope), _outerClass(t_class)
+{
+    t_scope = this;
+    t_class = nullptr;
+}
+
+AllocationScope::AllocationScope(AllocationScope *outer)
+    : _previous(t_scope), _outer(outer), _outerClass(t_class)
+{
+    t_scope = this;
+    t_class = nullptr;
+}
+
+AllocationScope::~AllocationScope()
+{
+    t_scope = _previous;
+    t_class = _outerClass;
+
+    Busy busy;
+
+    if (_outer)
+    {
+        QMutexLocker locker(&mergeMutex());
+        _outer->_total += _total;
+        for (QHash<const QMetaObject*, AllocationStats*>::const_iterator it = _perClass.constBegin(); it != _perClass.constEnd(); ++it)
+        {
+            AllocationStats *&stats = _outer->_perClass[it.key()];
+            if (!stats)
+                stats = new AllocationStats();
+            *stats += *it.value();
+        }
+    }
+
+    qDeleteAll(_perClass);
+}
+
+AllocationStats AllocationScope::stats(const QString &className) const
+{
+    AllocationStats retVal;
+    for (QHash<const QMetaObject*, AllocationStats*>::const_iterator it = _perClass.constBegin(); it != _perClass.constEnd(); ++it)
+        if (className == it.key()->className())
+            retVal += *it.value();
+    return retVal;
+}
+
+QHash<QString, AllocationStats> AllocationScope::perClass() const
+{
+    QHash<QString, AllocationStats> retVal;
+    for (QHash<const QMetaObject*, AllocationStats*>::const_iterator it = _perClass.constBegin(); it != _perClass.constEnd(); ++it)
+        retVal[it.key()->className()] += *it.value();
+    return retVal;
+}
+
+AllocationScope* AllocationScope::current()
+{
+    return t_scope;
+}
+
+bool AllocationScope::isInstrumented()
+{
+#ifdef JENSON_ALLOCATION_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocationScope::recordAllocation(std::size_t size)
+{
+    AllocationScope *scope = t_scope;
+    if (!scope || t_busy)
+        return;
+
+    scope->_total.allocations++;
+    scope->_total.allocatedBytes += size;
+    if (t_class)
+    {
+        t_class->allocations++;
+        t_class->allocatedBytes += size;
+    }
+}
+
+void AllocationScope::record(quint64 AllocationStats::*counter)
+{
+    AllocationScope *scope = t_scope;
+    if (!scope)
+        return;
+
+    scope->_total.*counter += 1;
+    if (t_class)
+        t_class->*counter += 1;
+}
+
+
+//
+// AllocationScope::Class
+//
+
+AllocationScope::Class::Class(const QMetaObject *metaObject)
+    : _previous(t_class), _active(t_scope && metaObject)
+{
+    if (!_active)
+        return;
+
+    Busy busy;
+    AllocationStats *&stats = t_scope->_perClass[metaObject];
+    if (!stats)
+        stats = new AllocationStats();
+    t_class = stats;
+}
+
+AllocationScope::Class::~Class()
+{
+    if (_active)
+        t_class = _previous;
+}
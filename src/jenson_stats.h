@@ -0,0 +1,132 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+#ifndef JENSON_STATS_H
+#define JENSON_STATS_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <QHash>
+#include <QString>
+#include "jenson_global.hpp"
+
+struct QMetaObject;
+
+//
+// Opt-in allocation accounting of (de)serialization calls.
+//
+// While an AllocationScope is alive, the calls on its thread are counted in total()
+// and per class, attributed to the class whose object is being (de)serialized.
+// Items the call hands to parallel worker threads are included, the asynchronous
+// methods are not, they may outlive the scope:
+//
+//     jenson::AllocationScope scope;
+//     sptr<QObject> obj = jenson::JenSON::deserializeToObject(&json);
+//     quint64 objects = scope.total().objects;
+//     quint64 variants = scope.stats("Testobject").variants;
+//
+// The objects, variants and jsonValues counters require a library built with
+// -DAllocationStats=ON (see isInstrumented()). Heap allocations are counted by the
+// global operator new of JENSON_TRACK_HEAP_ALLOCATIONS, placed in one source file
+// of the application.
+//
+
+#define JENSON_TRACK_HEAP_ALLOCATIONS \
+    void* operator new(std::size_t size) \
+    { \
+        jenson::AllocationScope::recordAllocation(size); \
+        void *ptr = std::malloc(size ? size : 1); \
+        if (!ptr) throw std::bad_alloc(); \
+        return ptr; \
+    } \
+    void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+namespace jenson
+{
+    struct JENSONSHARED_EXPORT AllocationStats
+    {
+        quint64 allocations;        // Heap allocations (JENSON_TRACK_HEAP_ALLOCATIONS)
+        quint64 allocatedBytes;
+        quint64 objects;            // QObjects constructed by the deserializers and custom serializers
+        quint64 variants;           // Temporary QVariants of property reads and writes
+        quint64 jsonValues;         // Temporary QJsonValues
+
+        AllocationStats() : allocations(0), allocatedBytes(0), objects(0), variants(0), jsonValues(0) {}
+
+        AllocationStats& operator+=(const AllocationStats &other);
+    };
+
+    class JENSONSHARED_EXPORT AllocationScope
+    {
+    private:
+        AllocationScope *_previous;     // Scope of the thread before this one
+        AllocationScope *_outer;        // Includes the counts on destruction, may live on another thread
+        AllocationStats *_outerClass;
+        AllocationStats _total;
+        QHash<const QMetaObject*, AllocationStats*> _perClass;
+
+        AllocationScope(const AllocationScope&) = delete;
+        AllocationScope& operator=(const AllocationScope&) = delete;
+
+    public:
+        // Starts counting on the current thread, an enclosing scope includes the counts on destruction
+        AllocationScope();
+        ~AllocationScope();
+
+        // Starts counting on the current thread for outer, a scope of a thread that waits for this one,
+        // e.g. the workers of a parallel loop. outer includes the counts on destruction.
+        explicit AllocationScope(AllocationScope *outer);
+
+        const AllocationStats& total() const { return _total; }
+
+        // Counts attributed to className, zero if none
+        AllocationStats stats(const QString &className) const;
+        QHash<QString, AllocationStats> perClass() const;
+
+        // True if the library counts objects, variants and jsonValues
+        static bool isInstrumented();
+
+        // Innermost scope of the current thread, nullptr if none
+        static AllocationScope* current();
+
+        // Hooks of JENSON_TRACK_HEAP_ALLOCATIONS and the (de)serializers
+        static void recordAllocation(std::size_t size);
+        static void record(quint64 AllocationStats::*counter);
+
+        // Attributes the counts to metaObject while in scope
+        class JENSONSHARED_EXPORT Class
+        {
+        private:
+            AllocationStats *_previous;
+            bool _active;
+
+            Class(const Class&) = delete;
+            Class& operator=(const Class&) = delete;
+
+        public:
+            explicit Class(const QMetaObject *metaObject);
+            ~Class();
+        };
+    };
+}
+
+#endif // JENSON_STATS_H
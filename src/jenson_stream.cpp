@@ -0,0 +1,983 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson.h"
+#include "jenson_p.h"
+#include "jenson_writer.h"
+#include "jenson_reader.h"
+#include "jenson_cbor.h"
+
+#include <QFile>
+#include <QIODevice>
+#include <QSaveFile>
+#include <QVarLengthArray>
+
+using namespace jenson;
+
+
+//
+// Format factories
+//
+
+static void checkFormat(JenSON::Format format)
+{
+#ifndef JENSON_CBOR
+    if (format == JenSON::Cbor)
+    {
+        QString msg("CBOR support is not built, configure with -DCbor=ON");
+        throw SerializationException(msg);
+    }
+#else
+    Q_UNUSED(format)
+#endif
+}
+
+template <typename Output>
+static std::unique_ptr<AbstractWriter> createWriter(Output *output, JenSON::Format format)
+{
+    checkFormat(format);
+#ifdef JENSON_CBOR
+    if (format == JenSON::Cbor)
+        return std::unique_ptr<AbstractWriter>(new CborWriter(output));
+#endif
+    return std::unique_ptr<AbstractWriter>(new JsonWriter(output));
+}
+
+template <typename Input>
+static std::unique_ptr<AbstractReader> createReader(Input input, JenSON::Format format)
+{
+    checkFormat(format);
+#ifdef JENSON_CBOR
+    if (format == JenSON::Cbor)
+        return std::unique_ptr<AbstractReader>(new CborReader(input));
+#endif
+    return std::unique_ptr<AbstractReader>(new JsonReader(input));
+}
+
+
+//
+// Streaming serialization, mirrors ::serialize in jenson.cpp without building a QJsonObject
+//
+
+static void writeObject(AbstractWriter *writer, const QObject *qObj, const ClassPlan *plan);
+
+// Properties holding these values are skipped by JenSON::serialize
+static bool isSerializable(const QVariant &var)
+{
+    if (var.type() == QVariant::Invalid)
+        return false;
+    if (var.type() == QVariant::UserType)
+        return qvariant_cast<QObject*>(var) != nullptr;
+    return true;
+}
+
+static bool writeVariant(AbstractWriter *writer, const QVariant &var)
+{
+    QObject *nestedObj = nullptr;
+    QJsonValue v;
+
+    switch (var.type())
+    {
+    case QVariant::Invalid:
+        return false;
+
+    case QVariant::UserType:
+        nestedObj = qvariant_cast<QObject*>(var);
+        if (!nestedObj)
+            return false;
+        writeObject(writer, nestedObj, ClassPlan::get(nestedObj->metaObject()));
+        break;
+
+    case QVariant::Bool:
+        writer->writeBool(var.toBool());
+        break;
+
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+        writer->writeInteger(var.toLongLong());
+        break;
+
+    case QVariant::Double:
+        writer->writeDouble(var.toDouble());
+        break;
+
+    case QVariant::Uuid:
+        writer->writeUuid(var.toUuid());
+        break;
+
+    case QVariant::String:
+        writer->writeString(var.toString());
+        break;
+
+    case QVariant::StringList:
+        writer->beginArray();
+        foreach (const QString &str, var.toStringList())
+            writer->writeString(str);
+        writer->endArray();
+        break;
+
+    case QVariant::List:
+        writer->beginArray();
+        foreach (const QVariant &lvar, var.toList())
+        {
+            writer->beginObject();
+
+            QObject *qObj = qvariant_cast<QObject*>(lvar);
+            if (qObj)
+            {
+                const ClassPlan *plan = ClassPlan::get(qObj->metaObject());
+                writer->writeKey(plan->serialName);
+                writeObject(writer, qObj, plan);
+            }
+            else
+            {
+                writer->writeKey(JenSON::toSerialName(lvar.typeName()));
+                if (!writeVariant(writer, lvar))
+                {
+                    writer->writeNull();
+                    writer->endObject();
+                    break;
+                }
+            }
+
+            writer->endObject();
+        }
+        writer->endArray();
+        break;
+
+    default:
+        v = QJsonValue::fromVariant(var);
+
+        if (v.isNull())
+        {
+            QString msg("Serialization::serialize not implemented for ");
+            msg.append(var.typeName());
+            throw SerializationException(msg);
+        }
+
+        writer->writeValue(v);
+        break;
+    }
+
+    return true;
+}
+
+static void writeArray(AbstractWriter *writer, const QVariant &var, ArrayType array)
+{
+    if (array == DoubleArray)
+    {
+        const QVector<double> values = var.value<QVector<double>>();
+        writer->writeArray(values.constData(), values.count());
+    }
+    else if (array == FloatArray)
+    {
+        const QVector<float> values = var.value<QVector<float>>();
+        writer->writeArray(values.constData(), values.count());
+    }
+    else
+    {
+        const QVector<int> values = var.value<QVector<int>>();
+        writer->writeArray(values.constData(), values.count());
+    }
+}
+
+template <typename T>
+static bool readArray(AbstractReader *reader, QVariant *var)
+{
+    QVector<T> values;
+    if (!reader->readArray(&values))
+        return false;
+    var->setValue(values);
+    return true;
+}
+
+// Writes a JENSON_FIELDS property without QVariant boxing, null objects are skipped
+static bool writeField(AbstractWriter *writer, const QObject *qObj, const PropertyPlan &prop, const QString *key)
+{
+    const IField *field = prop.field;
+
+    if (field->kind() == IField::Object)
+    {
+        QObject *nestedObj = field->object(qObj);
+        if (!nestedObj)
+            return false;
+        if (key) writer->writeKey(*key);
+        writeObject(writer, nestedObj, ClassPlan::get(nestedObj->metaObject()));
+        return true;
+    }
+
+    JENSON_STATS_COUNT(jsonValues);
+    QJsonValue v = field->toJson(qObj);
+    if (key) writer->writeKey(*key);
+    switch (field->kind())
+    {
+    case IField::Bool:
+        writer->writeBool(v.toBool());
+        break;
+    case IField::Integer:
+        writer->writeInteger(v.toInt());
+        break;
+    case IField::Number:
+        writer->writeDouble(v.toDouble());
+        break;
+    default:
+        writer->writeValue(v);
+        break;
+    }
+    return true;
+}
+
+static void writeContainer(AbstractWriter *writer, const QVariant &var, const PropertyPlan &prop);
+
+// Writes the key (unless nullptr) and the value of a property, returns false if the property is skipped
+static bool writeProperty(AbstractWriter *writer, const QObject *qObj, const PropertyPlan &prop, const QString *key)
+{
+    // Unmaterialized lazy properties are written as read
+    if (prop.lazyGet.isValid())
+    {
+        QJsonValue json = lazyJson(qObj, prop);
+        if (!json.isUndefined())
+        {
+            if (key) writer->writeKey(*key);
+            writer->writeValue(json);
+            return true;
+        }
+    }
+
+    bool written = true;
+    if (prop.precision >= 0)
+        writer->setPrecision(prop.precision);
+
+    if (prop.array != NoArray)
+    {
+        JENSON_STATS_COUNT(variants);
+        if (key) writer->writeKey(*key);
+        writeArray(writer, prop.property.read(qObj), prop.array);
+    }
+    else if (prop.container)
+    {
+        JENSON_STATS_COUNT(variants);
+        if (key) writer->writeKey(*key);
+        writeContainer(writer, prop.property.read(qObj), prop);
+    }
+    else if (prop.field)
+    {
+        written = writeField(writer, qObj, prop, key);
+    }
+    else
+    {
+        JENSON_STATS_COUNT(variants);
+        QVariant var = prop.property.read(qObj);
+        written = isSerializable(var);
+        if (written)
+        {
+            if (key) writer->writeKey(*key);
+            writeVariant(writer, var);
+        }
+    }
+
+    if (prop.precision >= 0)
+        writer->setPrecision(-1);
+    return written;
+}
+
+// Writes the elements of a typed container property without serial name wrapper, as rows or columns
+static void writeContainer(AbstractWriter *writer, const QVariant &var, const PropertyPlan &prop)
+{
+    const ClassPlan *plan = ClassPlan::get(prop.nestedMeta);
+    const int count = prop.container->count(var);
+
+    if (writesColumns(prop, plan, var))
+    {
+        JENSON_STATS_CLASS(plan->metaObject);
+        Timing timing(plan->metaObject, &ClassStats::serialize, nullptr, writer);
+
+        writer->beginObject();
+        writer->writeKey("class");
+        writer->writeString(plan->serialName);
+        writer->writeKey("count");
+        writer->writeInteger(count);
+        writer->writeKey("columns");
+        writer->beginObject();
+        foreach (const PropertyPlan &column, plan->readable)
+        {
+            writer->writeKey(column.key);
+            writer->beginArray();
+            for (int i = 0; i < count; i++)
+                if (!writeProperty(writer, prop.container->at(var, i), column, nullptr))
+                    writer->writeNull();
+            writer->endArray();
+        }
+        writer->endObject();
+        writer->endObject();
+        return;
+    }
+
+    writer->beginArray();
+    for (int i = 0; i < count; i++)
+    {
+        QObject *element = prop.container->at(var, i);
+        if (element)
+            writeObject(writer, element, plan);
+        else
+            writer->writeNull();
+    }
+    writer->endArray();
+}
+
+static void writeObject(AbstractWriter *writer, const QObject *qObj, const ClassPlan *plan)
+{
+    JENSON_STATS_CLASS(plan->metaObject);
+    Timing timing(plan->metaObject, plan->serializer ? &ClassStats::customSerialize : &ClassStats::serialize, nullptr, writer);
+    AsyncProgress::update(writer);
+
+    if (plan->serializer)
+    {
+        JENSON_STATS_COUNT(jsonValues);
+        writer->writeValue(plan->serializer->serialize(qObj));
+        return;
+    }
+
+    writer->beginObject();
+    foreach (const PropertyPlan &prop, plan->readable)
+        writeProperty(writer, qObj, prop, &prop.key);
+    writer->endObject();
+}
+
+void jenson::writeRoot(AbstractWriter *writer, const QObject *qObj)
+{
+    const ClassPlan *plan = ClassPlan::get(qObj->metaObject());
+
+    writer->beginObject();
+    writer->writeKey(plan->serialName);
+    writeObject(writer, qObj, plan);
+    writer->endObject();
+}
+
+
+//
+// Streaming deserialization, mirrors the DOM path in jenson.cpp without building a QJsonObject
+//
+
+static sptr<QObject> readObject(AbstractReader *reader, const ClassPlan *plan, QString *errorMsg);
+
+// Skips the remaining members of the current object, up to its EndObject
+static void skipRest(AbstractReader *reader)
+{
+    while (reader->next() == AbstractReader::Key)
+    {
+        reader->next();
+        reader->skipValue();
+    }
+}
+
+static void appendReaderError(const AbstractReader *reader, QString *errorMsg)
+{
+    if (errorMsg && reader->hasError())
+        errorMsg->append("\n Json parse error: " + reader->errorString());
+}
+
+static sptr<QObject> readClassValue(AbstractReader *reader, const ClassPlan *plan, QString *errorMsg)
+{
+    // Use custom deserializer if available, bridged through a QJsonValue
+    if (plan->serializer)
+    {
+        JENSON_STATS_CLASS(plan->metaObject);
+        Timing timing(plan->metaObject, &ClassStats::customDeserialize, reader);
+        JENSON_STATS_COUNT(jsonValues);
+        QJsonValue value = reader->readValue();
+        if (reader->hasError())
+            return nullptr;
+        JENSON_STATS_COUNT(objects);
+        return plan->serializer->deserialize(&value, errorMsg);
+    }
+
+    return readObject(reader, plan, errorMsg);
+}
+
+// Reads a QVariant::List item ({"serialName": value}), throws like the DOM path
+static QVariant readListItem(AbstractReader *reader)
+{
+    if (reader->token() != AbstractReader::BeginObject || reader->next() != AbstractReader::Key)
+    {
+        QString msg("\n Invalid list item");
+        appendReaderError(reader, &msg);
+        throw SerializationException(msg);
+    }
+
+    QString firstKey = reader->text();
+    reader->next();
+
+    // deserialize QVariant supported type
+    int typeId = QVariant::nameToType(firstKey.toStdString().c_str());
+    if (typeId != QVariant::Invalid && typeId != QVariant::UserType && reader->token() != AbstractReader::Null)
+    {
+        JENSON_STATS_COUNT(jsonValues);
+        QVariant var = reader->readValue().toVariant();
+        skipRest(reader);
+        return var;
+    }
+
+    // deserialize custom type
+    QString errorMsg;
+    sptr<QObject> obj;
+    const ClassPlan *plan = resolveSerialName(firstKey, &errorMsg);
+    if (plan)
+        obj = readClassValue(reader, plan, &errorMsg);
+
+    if (!obj || reader->next() != AbstractReader::EndObject)
+    {
+        if (obj) errorMsg.append("\n JsonObj contains multiple keys");
+        appendReaderError(reader, &errorMsg);
+        throw SerializationException(errorMsg);
+    }
+
+    QVariant vObj;
+    vObj.setValue(obj.release());
+    return vObj;
+}
+
+static bool readProperty(AbstractReader *reader, QObject *target, const PropertyPlan &prop, QString *errorMsg);
+
+// Reads the columnar layout of a typed container in place, the elements are created as the
+// first column arrives (the count may follow the columns). The reader is after the layout
+// unless it has an error.
+static bool readColumns(AbstractReader *reader, const ClassPlan *plan, std::vector<sptr<QObject>> *elements, QString *errorMsg)
+{
+    JENSON_STATS_CLASS(plan->metaObject);
+    Timing timing(plan->metaObject, &ClassStats::deserialize, reader);
+
+    bool valid = !plan->serializer;
+    bool hasClass = false;
+    int count = -1;
+    QVarLengthArray<int, 32> filled(plan->writable.count());
+    for (int i = 0; i < filled.size(); i++)
+        filled[i] = -1;
+
+    while (reader->next() == AbstractReader::Key)
+    {
+        const QString key = reader->text();
+        reader->next();
+
+        if (key == "class" && reader->token() == AbstractReader::String)
+        {
+            hasClass = true;
+            valid = valid && reader->text() == plan->serialName;
+        }
+        else if (key == "count" && reader->token() == AbstractReader::Number)
+        {
+            count = reader->number() >= 0 && reader->number() <= INT_MAX ? int(reader->number()) : -1;
+            valid = valid && count >= 0;
+        }
+        else if (key == "columns" && reader->token() == AbstractReader::BeginObject)
+        {
+            while (reader->next() == AbstractReader::Key)
+            {
+                const int idx = plan->indexOfWritable(reader->text());
+                reader->next();
+
+                if (idx < 0 || !valid || reader->token() != AbstractReader::BeginArray)
+                {
+                    valid = valid && idx < 0;
+                    reader->skipValue();
+                    continue;
+                }
+
+                const PropertyPlan &prop = plan->writable.at(idx);
+                int i = 0;
+                while (reader->next() != AbstractReader::EndArray && !reader->hasError())
+                {
+                    if (!valid)
+                    {
+                        reader->skipValue();
+                        continue;
+                    }
+
+                    if (i == int(elements->size()))
+                        elements->push_back(newInstance(plan));
+                    QObject *element = elements->at(i++).get();
+
+                    // Nulls are missing values, like the absent keys of a row
+                    if (reader->token() == AbstractReader::Null)
+                        valid = deserializeProperty(element, prop, QJsonValue(QJsonValue::Undefined), errorMsg);
+                    else
+                        valid = readProperty(reader, element, prop, errorMsg);
+                }
+                filled[idx] = i;
+            }
+        }
+        else
+        {
+            reader->skipValue();
+        }
+
+        if (reader->hasError())
+            return false;
+    }
+
+    if (reader->token() != AbstractReader::EndObject)
+        return false;
+
+    // Every column holds count values
+    for (int i = 0; valid && i < filled.size(); i++)
+        valid = filled[i] < 0 || filled[i] == count;
+    if (!valid || !hasClass || count < 0)
+    {
+        if (errorMsg) errorMsg->append("\n Invalid columns of class " + plan->serialName);
+        return false;
+    }
+
+    while (int(elements->size()) < count)
+        elements->push_back(newInstance(plan));
+
+    // Missing columns behave as missing keys
+    for (int idx = 0; idx < filled.size(); idx++)
+        for (int i = qMax(filled[idx], 0); i < count; i++)
+            if (!deserializeProperty(elements->at(i).get(), plan->writable.at(idx), QJsonValue(QJsonValue::Undefined), errorMsg))
+                return false;
+
+    for (const sptr<QObject> &element : *elements)
+        finishObject(element.get(), plan);
+    return true;
+}
+
+// Reads the elements of a typed container property (rows or columns) in place, parented to target.
+// Returns false if an element failed, the reader is after the value unless it has an error.
+static bool readContainer(AbstractReader *reader, QObject *target, const PropertyPlan &prop, QString *errorMsg)
+{
+    const ClassPlan *plan = ClassPlan::get(prop.nestedMeta);
+    std::vector<sptr<QObject>> owned;
+    QVector<QObject*> elements;
+
+    if (reader->token() == AbstractReader::BeginObject)
+    {
+        if (!readColumns(reader, plan, &owned, errorMsg))
+            return false;
+        for (const sptr<QObject> &element : owned)
+            elements.append(element.get());
+    }
+    else
+    {
+        while (reader->next() != AbstractReader::EndArray && !reader->hasError())
+        {
+            if (reader->token() == AbstractReader::Null)
+            {
+                elements.append(nullptr);
+                continue;
+            }
+
+            sptr<QObject> element = readClassValue(reader, plan, errorMsg);
+            if (!element)
+            {
+                while (reader->next() != AbstractReader::EndArray && !reader->hasError())
+                    reader->skipValue();
+                return false;
+            }
+
+            elements.append(element.get());
+            owned.push_back(std::move(element));
+        }
+
+        if (reader->hasError())
+            return false;
+    }
+
+    for (const sptr<QObject> &element : owned)
+        element->setParent(target);
+
+    JENSON_STATS_COUNT(variants);
+    if (!prop.property.write(target, prop.container->fromObjects(elements.constData(), elements.count())))
+        return false;
+
+    for (sptr<QObject> &element : owned)
+        element.release();
+    return true;
+}
+
+static bool readProperty(AbstractReader *reader, QObject *target, const PropertyPlan &prop, QString *errorMsg)
+{
+    QVariant var;
+    QList<QVariant> varList;
+    bool writeSucceeded = false;
+
+    // Lazy properties keep the raw Json until first use, the nested value is skipped without decoding it
+    if (prop.lazySetRaw.isValid())
+    {
+        QByteArray source;
+        int offset, length;
+        if (reader->rawValue(&source, &offset, &length))
+            return prop.lazySetRaw.invoke(target, Qt::DirectConnection,
+                                          Q_ARG(QByteArray, source), Q_ARG(int, offset), Q_ARG(int, length));
+        if (reader->hasError())
+            return false;
+    }
+
+    // Numeric arrays are decoded without intermediate values
+    if (prop.array != NoArray && (reader->token() == AbstractReader::BeginArray || reader->packed() != AbstractReader::NotPacked))
+    {
+        bool ok = false;
+        if (prop.array == DoubleArray)
+            ok = readArray<double>(reader, &var);
+        else if (prop.array == FloatArray)
+            ok = readArray<float>(reader, &var);
+        else
+            ok = readArray<int>(reader, &var);
+
+        if (reader->hasError())
+            return false;
+        JENSON_STATS_COUNT(variants);
+        if (ok)
+            writeSucceeded = prop.property.write(target, var);
+        if (!writeSucceeded)
+            return handleWriteFailure(target, prop, prop.className, errorMsg);
+        return true;
+    }
+
+    // Typed containers are read element by element
+    if (prop.container && (reader->token() == AbstractReader::BeginArray || reader->token() == AbstractReader::BeginObject))
+    {
+        if (!readContainer(reader, target, prop, errorMsg))
+        {
+            if (reader->hasError())
+                return false;
+            return handleWriteFailure(target, prop, prop.className, errorMsg);
+        }
+        return true;
+    }
+
+    switch (prop.type)
+    {
+    case QVariant::UserType:
+        // Nested objects of the declared class are read in place,
+        // custom serializers and polymorphic wrappers use the DOM bridge
+        if (!prop.serializer && !prop.container && !prop.lazySet.isValid() && prop.nestedMeta && reader->token() == AbstractReader::BeginObject)
+        {
+            QObject *nestedObj = readObject(reader, ClassPlan::get(prop.nestedMeta), errorMsg).release();
+            if (nestedObj)
+            {
+                nestedObj->setParent(target);
+                if (prop.field)
+                {
+                    writeSucceeded = prop.field->setObject(target, nestedObj);
+                }
+                else
+                {
+                    JENSON_STATS_COUNT(variants);
+                    var.setValue(nestedObj);
+                    writeSucceeded = prop.property.write(target, var);
+                }
+            }
+            else if (reader->hasError())
+            {
+                return false;
+            }
+
+            if (!writeSucceeded)
+                return handleWriteFailure(target, prop, prop.className, errorMsg);
+            return true;
+        }
+        break;
+
+    case QVariant::List:
+        if (reader->token() == AbstractReader::BeginArray)
+        {
+            while (reader->next() != AbstractReader::EndArray && !reader->hasError())
+                varList.append(readListItem(reader));
+
+            if (reader->hasError())
+                return false;
+
+            JENSON_STATS_COUNT(variants);
+            writeSucceeded = prop.property.write(target, varList);
+            if (!writeSucceeded)
+                return handleWriteFailure(target, prop, prop.className, errorMsg);
+            return true;
+        }
+        break;
+
+    case QVariant::StringList:
+        break;
+
+    default:
+        // Typed fields take values of their own Json type directly
+        if (prop.field && reader->token() >= AbstractReader::String && reader->token() <= AbstractReader::Bool)
+        {
+            JENSON_STATS_COUNT(jsonValues);
+            QJsonValue value = reader->readValue();
+            if (prop.field->fromJson(target, value))
+                return true;
+            return deserializeProperty(target, prop, value, errorMsg);
+        }
+
+        // Scalars are written as read, so formats can keep their native types
+        if (reader->token() >= AbstractReader::String && reader->token() <= AbstractReader::Other)
+        {
+            JENSON_STATS_COUNT(variants);
+            writeSucceeded = prop.property.write(target, reader->variant());
+            if (!writeSucceeded)
+                return handleWriteFailure(target, prop, prop.className, errorMsg);
+            return true;
+        }
+        break;
+    }
+
+    // Everything else uses the same conversions as the DOM path
+    JENSON_STATS_COUNT(jsonValues);
+    QJsonValue value = reader->readValue();
+    if (reader->hasError())
+        return false;
+    return deserializeProperty(target, prop, value, errorMsg);
+}
+
+static sptr<QObject> readObject(AbstractReader *reader, const ClassPlan *plan, QString *errorMsg)
+{
+    JENSON_STATS_CLASS(plan->metaObject);
+    Timing timing(plan->metaObject, &ClassStats::deserialize, reader);
+    AsyncProgress::update(reader);
+
+    sptr<QObject> retVal = newInstance(plan);
+
+    // Non-object values deserialize as an empty object (like QJsonValue::toObject)
+    if (reader->token() != AbstractReader::BeginObject)
+    {
+        if (!reader->skipValue())
+            return nullptr;
+        foreach (const PropertyPlan &prop, plan->writable)
+            if (!deserializeProperty(retVal.get(), prop, QJsonValue(QJsonValue::Undefined), errorMsg))
+                return nullptr;
+        finishObject(retVal.get(), plan);
+        return retVal;
+    }
+
+    QVarLengthArray<bool, 32> seen(plan->writable.count());
+    for (int i = 0; i < seen.size(); i++)
+        seen[i] = false;
+
+    // Write the properties as they arrive
+    while (reader->next() == AbstractReader::Key)
+    {
+        int idx = plan->indexOfWritable(reader->text());
+        reader->next();
+
+        if (idx < 0)
+        {
+            reader->skipValue();
+            continue;
+        }
+
+        seen[idx] = true;
+        if (!readProperty(reader, retVal.get(), plan->writable.at(idx), errorMsg))
+        {
+            // Leave the reader at the end of this object
+            skipRest(reader);
+            return nullptr;
+        }
+    }
+
+    if (reader->token() != AbstractReader::EndObject)
+        return nullptr;
+
+    // Missing properties behave as in the DOM path
+    for (int i = 0; i < seen.size(); i++)
+        if (!seen[i] && !deserializeProperty(retVal.get(), plan->writable.at(i), QJsonValue(QJsonValue::Undefined), errorMsg))
+            return nullptr;
+
+    finishObject(retVal.get(), plan);
+
+    return retVal;
+}
+
+static sptr<QObject> readRoot(AbstractReader *reader, QString *errorMsg)
+{
+    sptr<QObject> retVal;
+
+    if (reader->next() != AbstractReader::BeginObject)
+    {
+        if (errorMsg && !reader->hasError())
+            errorMsg->append("\n Root value is not a json object");
+    }
+    else if (reader->next() != AbstractReader::Key)
+    {
+        if (errorMsg && !reader->hasError())
+            errorMsg->append("\n Empty json object");
+    }
+    else
+    {
+        const ClassPlan *plan = resolveSerialName(reader->text(), errorMsg);
+        if (plan)
+        {
+            reader->next();
+            retVal = readClassValue(reader, plan, errorMsg);
+
+            if (retVal && reader->next() != AbstractReader::EndObject)
+            {
+                if (errorMsg && !reader->hasError())
+                    errorMsg->append("\n JsonObj contains multiple keys");
+                retVal.reset();
+            }
+            else if (retVal && reader->next() != AbstractReader::EndOfInput)
+            {
+                retVal.reset();
+            }
+        }
+    }
+
+    appendReaderError(reader, errorMsg);
+    if (reader->hasError())
+        retVal.reset();
+
+    return retVal;
+}
+
+
+//
+// Streaming static class methods
+//
+
+void JenSON::serialize(const QObject *qObj, QByteArray *data, Format format)
+{
+    std::unique_ptr<AbstractWriter> writer = createWriter(data, format);
+    writeRoot(writer.get(), qObj);
+}
+
+void jenson::writeRecording(const RecordingWriter *recording, QByteArray *data, JenSON::Format format)
+{
+    std::unique_ptr<AbstractWriter> writer = createWriter(data, format);
+    recording->replay(writer.get());
+}
+
+void JenSON::serialize(const QObject *qObj, QIODevice *device, Format format)
+{
+    std::unique_ptr<AbstractWriter> writer = createWriter(device, format);
+    writeRoot(writer.get(), qObj);
+
+    if (!writer->flush())
+    {
+        QString msg = "serialization::serialize failed to write to device: " + device->errorString();
+        throw SerializationException(msg);
+    }
+}
+
+sptr<QObject> JenSON::deserializeFrom(const QByteArray &data, Format format)
+{
+    QString errorMsg;
+    sptr<QObject> retVal = deserializeFrom(data, &errorMsg, format);
+
+    if (!retVal)
+        throw SerializationException(errorMsg);
+
+    return retVal;
+}
+
+sptr<QObject> JenSON::deserializeFrom(QIODevice *device, Format format)
+{
+    QString errorMsg;
+    sptr<QObject> retVal = deserializeFrom(device, &errorMsg, format);
+
+    if (!retVal)
+        throw SerializationException(errorMsg);
+
+    return retVal;
+}
+
+sptr<QObject> JenSON::deserializeFrom(const QByteArray &data, QString *errorMsg, Format format)
+{
+    std::unique_ptr<AbstractReader> reader = createReader<const QByteArray&>(data, format);
+    return readRoot(reader.get(), errorMsg);
+}
+
+sptr<QObject> JenSON::deserializeFrom(QIODevice *device, QString *errorMsg, Format format)
+{
+    std::unique_ptr<AbstractReader> reader = createReader(device, format);
+    return readRoot(reader.get(), errorMsg);
+}
+
+void JenSON::serializeFile(const QObject *qObj, const QString &path, Format format)
+{
+    QString errorMsg;
+    if (!serializeFile(qObj, path, &errorMsg, format))
+        throw SerializationException(errorMsg);
+}
+
+bool JenSON::serializeFile(const QObject *qObj, const QString &path, QString *errorMsg, Format format)
+{
+    // The writers buffer in large chunks, QSaveFile would copy them into its own buffer
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Unbuffered))
+    {
+        if (errorMsg) errorMsg->append("\n Failed to open " + path + ": " + file.errorString());
+        return false;
+    }
+
+    {
+        std::unique_ptr<AbstractWriter> writer = createWriter<QIODevice>(&file, format);
+        writeRoot(writer.get(), qObj);
+        if (!writer->flush())
+        {
+            if (errorMsg) errorMsg->append("\n Failed to write " + path + ": " + file.errorString());
+            return false;
+        }
+    }
+
+    if (!file.commit())
+    {
+        if (errorMsg) errorMsg->append("\n Failed to save " + path + ": " + file.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+sptr<QObject> JenSON::deserializeFile(const QString &path, Format format)
+{
+    QString errorMsg;
+    sptr<QObject> retVal = deserializeFile(path, &errorMsg, format);
+
+    if (!retVal)
+        throw SerializationException(errorMsg);
+
+    return retVal;
+}
+
+sptr<QObject> JenSON::deserializeFile(const QString &path, QString *errorMsg, Format format)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (errorMsg) errorMsg->append("\n Failed to open " + path + ": " + file.errorString());
+        return nullptr;
+    }
+
+    // The readers only decode from the mapping, it is unmapped when the file closes
+    const qint64 size = file.size();
+    const uchar *mapped = (size > 0 && size <= INT_MAX) ? file.map(0, size) : nullptr;
+    if (!mapped)
+        return deserializeFrom(&file, errorMsg, format);
+
+    // Lazy properties copy their raw Json out of the mapping
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), int(size));
+    std::unique_ptr<AbstractReader> reader = createReader<const QByteArray&>(data, format);
+    reader->setCopyRawValues(true);
+    return readRoot(reader.get(), errorMsg);
+}
@@ -0,0 +1,307 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson_tracker.h"
+
+#include "jenson.h"
+#include "jenson_p.h"
+
+using namespace jenson;
+
+
+// Properties holding a single nested object, these are retracked and sent in full when replaced
+static bool isNestedObject(const PropertyPlan &prop)
+{
+    return prop.type == QVariant::UserType && !prop.serializer && !prop.container && prop.array == NoArray &&
+            !prop.lazyGet.isValid() && !(prop.field && prop.field->kind() != IField::Object);
+}
+
+static QJsonValue pollValue(const QObject *obj, const PropertyPlan &prop)
+{
+    QJsonValue value(QJsonValue::Undefined);
+    serializeProperty(obj, prop, &value);
+    return value;
+}
+
+
+//
+// ChangeTracker
+//
+
+ChangeTracker::ChangeTracker(QObject *root, QObject *parent) :
+    QObject(parent), _root(root), _revision(0)
+{
+    track(root, nullptr);
+}
+
+void ChangeTracker::track(QObject *obj, QObject *parent)
+{
+    if (_entries.contains(obj))
+        return;
+
+    const QMetaObject *meta = obj->metaObject();
+
+    Entry &entry = _entries[obj];
+    entry.parent = parent;
+    entry.subtreeRevision = 0;
+    entry.revisions.fill(0, meta->propertyCount());
+
+    // Snapshot the properties poll compares
+    const ClassPlan *plan = ClassPlan::get(meta);
+    for (int i = 0; i < plan->readable.count(); i++)
+    {
+        const PropertyPlan &prop = plan->readable.at(i);
+        if (!prop.property.hasNotifySignal())
+            entry.polled.insert(i, isNestedObject(prop) ? QJsonValue() : pollValue(obj, prop));
+    }
+
+    static const int notifySlot = ChangeTracker::staticMetaObject.indexOfSlot("onNotify()");
+    QMetaMethod onNotifyMethod = ChangeTracker::staticMetaObject.method(notifySlot);
+
+    // Properties may share a NOTIFY signal, connect each signal once
+    QVector<int> connected;
+    for (int i = 1; i < meta->propertyCount(); i++)
+    {
+        QMetaProperty mp = meta->property(i);
+        if (mp.hasNotifySignal() && !connected.contains(mp.notifySignalIndex()))
+        {
+            connect(obj, mp.notifySignal(), this, onNotifyMethod, Qt::DirectConnection);
+            connected.append(mp.notifySignalIndex());
+        }
+    }
+    connect(obj, &QObject::destroyed, this, &ChangeTracker::onDestroyed, Qt::DirectConnection);
+
+    // Track the nested objects
+    for (int i = 1; i < meta->propertyCount(); i++)
+        trackChild(obj, &_entries[obj], i);
+}
+
+void ChangeTracker::trackChild(QObject *obj, Entry *entry, int propertyIndex)
+{
+    QMetaProperty mp = obj->metaObject()->property(propertyIndex);
+    if (mp.type() != QVariant::UserType || !mp.isReadable())
+        return;
+
+    QObject *child = qvariant_cast<QObject*>(mp.read(obj));
+    if (!child || child == obj)
+        return;
+
+    entry->children.insert(propertyIndex, child);
+    track(child, obj); // May rehash _entries, entry is not used afterwards
+}
+
+void ChangeTracker::untrack(QObject *obj)
+{
+    QHash<const QObject*, Entry>::iterator it = _entries.find(obj);
+    if (it == _entries.end())
+        return;
+
+    QList<QObject*> children = it->children.values();
+    _entries.erase(it);
+    disconnect(obj, nullptr, this, nullptr);
+
+    foreach (QObject *child, children)
+    {
+        // Children shared with another tracked parent stay tracked
+        QHash<const QObject*, Entry>::iterator childIt = _entries.find(child);
+        if (childIt != _entries.end() && childIt->parent == obj)
+            untrack(child);
+    }
+}
+
+void ChangeTracker::changed(QObject *obj, int propertyIndex)
+{
+    QHash<const QObject*, Entry>::iterator it = _entries.find(obj);
+    if (it == _entries.end())
+        return;
+
+    _revision++;
+    it->revisions[propertyIndex] = _revision;
+
+    // A replaced child is retracked
+    QObject *oldChild = it->children.take(propertyIndex);
+    if (oldChild)
+        untrack(oldChild);
+    trackChild(obj, &_entries[obj], propertyIndex);
+
+    // Mark the subtree dirty up to the root
+    for (const QObject *o = obj; o; )
+    {
+        it = _entries.find(o);
+        if (it == _entries.end())
+            break;
+        it->subtreeRevision = _revision;
+        o = it->parent;
+    }
+}
+
+void ChangeTracker::poll()
+{
+    // changed() retracks children, iterate over a copy of the keys
+    const QList<const QObject*> objects = _entries.keys();
+    foreach (const QObject *obj, objects)
+    {
+        QHash<const QObject*, Entry>::iterator it = _entries.find(obj);
+        if (it == _entries.end() || it->polled.isEmpty())
+            continue;
+
+        const ClassPlan *plan = ClassPlan::get(obj->metaObject());
+        const QList<int> indexes = it->polled.keys();
+        foreach (int i, indexes)
+        {
+            const PropertyPlan &prop = plan->readable.at(i);
+            const int propertyIndex = prop.property.propertyIndex();
+
+            it = _entries.find(obj); // changed() may rehash
+            if (it == _entries.end())
+                break;
+
+            if (isNestedObject(prop))
+            {
+                QObject *child = nestedObject(obj, prop);
+                if (child != obj && child != it->children.value(propertyIndex))
+                    changed(const_cast<QObject*>(obj), propertyIndex);
+                continue;
+            }
+
+            QJsonValue value = pollValue(obj, prop);
+            if (value != it->polled.value(i))
+            {
+                it->polled.insert(i, value);
+                changed(const_cast<QObject*>(obj), propertyIndex);
+            }
+        }
+    }
+}
+
+void ChangeTracker::onNotify()
+{
+    QObject *obj = sender();
+    int signalIndex = senderSignalIndex();
+    if (!obj || signalIndex < 0)
+        return;
+
+    const QMetaObject *meta = obj->metaObject();
+    for (int i = 1; i < meta->propertyCount(); i++)
+        if (meta->property(i).notifySignalIndex() == signalIndex)
+            changed(obj, i);
+}
+
+void ChangeTracker::onDestroyed(QObject *obj)
+{
+    QHash<const QObject*, Entry>::iterator it = _entries.find(obj);
+    if (it == _entries.end())
+        return;
+
+    // Forget obj in its parent, then drop the entries of its whole subtree
+    QHash<const QObject*, Entry>::iterator parentIt = _entries.find(it->parent);
+    if (parentIt != _entries.end())
+    {
+        const QList<int> indexes = parentIt->children.keys(obj);
+        foreach (int i, indexes)
+            parentIt->children.remove(i);
+    }
+
+    untrack(obj);
+    if (obj == _root)
+        _root = nullptr;
+}
+
+quint64 ChangeTracker::propertyRevision(const QObject *obj, int propertyIndex) const
+{
+    QHash<const QObject*, Entry>::const_iterator it = _entries.constFind(obj);
+    if (it == _entries.constEnd() || propertyIndex < 0 || propertyIndex >= it->revisions.count())
+        return 0;
+    return it->revisions.at(propertyIndex);
+}
+
+quint64 ChangeTracker::subtreeRevision(const QObject *obj) const
+{
+    QHash<const QObject*, Entry>::const_iterator it = _entries.constFind(obj);
+    if (it == _entries.constEnd())
+        return 0;
+    return it->subtreeRevision;
+}
+
+
+//
+// Delta serialization
+//
+
+static QJsonObject serializeDeltaObject(const QObject *qObj, const ClassPlan *plan, const ChangeTracker *tracker, quint64 since)
+{
+    QJsonObject propObj;
+
+    foreach (const PropertyPlan &prop, plan->readable)
+    {
+        QJsonValue v;
+
+        // Changed (or replaced) since the last delta
+        if (tracker->propertyRevision(qObj, prop.property.propertyIndex()) > since)
+        {
+            if (!serializeProperty(qObj, prop, &v))
+                continue;
+
+            // Replaced nested objects are wrapped with their serial name, applyDelta deserializes them fresh
+            if (isNestedObject(prop))
+            {
+                QJsonObject wrapped;
+                wrapped.insert(ClassPlan::get(nestedObject(qObj, prop)->metaObject())->serialName, v);
+                v = wrapped;
+            }
+            propObj.insert(prop.key, v);
+            continue;
+        }
+
+        // Nested objects that are tracked only contribute their changes
+        if (prop.type == QVariant::UserType && !prop.serializer)
+        {
+            QObject *nestedObj = nestedObject(qObj, prop);
+            if (nestedObj && tracker->isTracked(nestedObj))
+            {
+                const ClassPlan *nestedPlan = ClassPlan::get(nestedObj->metaObject());
+                if (!nestedPlan->serializer && tracker->subtreeRevision(nestedObj) > since)
+                    propObj.insert(prop.key, serializeDeltaObject(nestedObj, nestedPlan, tracker, since));
+            }
+        }
+    }
+
+    return propObj;
+}
+
+QJsonObject JenSON::serializeDelta(const QObject *qObj, ChangeTracker *tracker, quint64 since)
+{
+    const ClassPlan *plan = ClassPlan::get(qObj->metaObject());
+
+    QJsonObject retVal;
+    if (plan->serializer || !tracker->isTracked(qObj))
+    {
+        retVal.insert(plan->serialName, serializeObject(qObj, plan));
+    }
+    else
+    {
+        tracker->poll();
+        retVal.insert(plan->serialName, serializeDeltaObject(qObj, plan, tracker, since));
+    }
+
+    return retVal;
+}
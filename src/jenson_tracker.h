@@ -0,0 +1,91 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#ifndef JENSON_TRACKER_H
+#define JENSON_TRACKER_H
+
+#include <QObject>
+#include <QHash>
+#include <QJsonValue>
+#include <QVector>
+#include "jenson_global.hpp"
+
+namespace jenson
+{
+    //
+    // Records property changes of an object tree through the properties' NOTIFY signals,
+    // use with JenSON::serializeDelta. Nested objects (QObject pointer properties) are
+    // tracked as well and retracked when their property notifies a change.
+    // Properties without NOTIFY signal are compared with their last value by poll.
+    // The tracker must live in the thread of the tracked objects.
+    //
+    class JENSONSHARED_EXPORT ChangeTracker : public QObject
+    {
+        Q_OBJECT
+
+    private:
+        struct Entry
+        {
+            QObject *parent;
+            quint64 subtreeRevision;            // Last change of the object or its descendants
+            QVector<quint64> revisions;         // Last change per property index
+            QHash<int, QObject*> children;      // Tracked child per property index
+            QHash<int, QJsonValue> polled;      // Last value per ClassPlan::readable index of the
+                                                // properties without NOTIFY signal, nested objects
+                                                // are compared with the tracked child instead
+        };
+
+        QObject *_root;
+        quint64 _revision;
+        QHash<const QObject*, Entry> _entries;
+
+        void track(QObject *obj, QObject *parent);
+        void trackChild(QObject *obj, Entry *entry, int propertyIndex);
+        void untrack(QObject *obj);
+        void changed(QObject *obj, int propertyIndex);
+
+    private slots:
+        void onNotify();
+        void onDestroyed(QObject *obj);
+
+    public:
+        explicit ChangeTracker(QObject *root, QObject *parent = nullptr);
+
+        QObject* root() const { return _root; }
+
+        // Current revision, increments with every change. Pass it as since to the next serializeDelta.
+        quint64 revision() const { return _revision; }
+
+        bool isTracked(const QObject *obj) const { return _entries.contains(obj); }
+
+        // Records the changes of the properties without NOTIFY signal, serializeDelta polls first
+        void poll();
+
+        // Revision of the last change of the property, 0 if it did not change since tracking started
+        quint64 propertyRevision(const QObject *obj, int propertyIndex) const;
+
+        // Revision of the last change of the object or one of its tracked descendants
+        quint64 subtreeRevision(const QObject *obj) const;
+    };
+}
+
+#endif // JENSON_TRACKER_H
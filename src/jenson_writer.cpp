@@ -0,0 +1,313 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+#include "jenson_writer.h"
+
+#include <cmath>
+#include <QIODevice>
+#include "jenson_number.h"
+
+using namespace jenson;
+
+// Size at which buffered output is handed to the device
+static const int DEVICE_CHUNK = 64 * 1024;
+
+
+//
+// JsonWriter
+//
+
+JsonWriter::JsonWriter(QByteArray *out)
+    : _out(out), _device(nullptr), _flushed(0), _start(out->size()), _needComma(false), _error(false)
+{
+}
+
+JsonWriter::JsonWriter(QIODevice *device)
+    : _out(&_buffer), _device(device), _flushed(0), _start(0), _needComma(false), _error(false)
+{
+    _buffer.reserve(DEVICE_CHUNK + DEVICE_CHUNK / 4);
+}
+
+JsonWriter::~JsonWriter()
+{
+    flush();
+}
+
+void JsonWriter::separate()
+{
+    if (_needComma)
+        _out->append(',');
+}
+
+void JsonWriter::flushIfFull()
+{
+    if (_device && _buffer.size() >= DEVICE_CHUNK)
+        flush();
+}
+
+bool JsonWriter::flush()
+{
+    if (!_device || _buffer.isEmpty())
+        return !_error;
+
+    if (_device->write(_buffer) != _buffer.size())
+        _error = true;
+    _flushed += _buffer.size();
+    _buffer.resize(0); // keeps the capacity
+
+    return !_error;
+}
+
+void JsonWriter::beginObject()
+{
+    separate();
+    _out->append('{');
+    _needComma = false;
+}
+
+void JsonWriter::endObject()
+{
+    _out->append('}');
+    _needComma = true;
+    flushIfFull();
+}
+
+void JsonWriter::beginArray()
+{
+    separate();
+    _out->append('[');
+    _needComma = false;
+}
+
+void JsonWriter::endArray()
+{
+    _out->append(']');
+    _needComma = true;
+    flushIfFull();
+}
+
+void JsonWriter::writeKey(const QString &key)
+{
+    separate();
+    appendEscaped(key);
+    _out->append(':');
+    _needComma = false;
+}
+
+void JsonWriter::writeNull()
+{
+    separate();
+    _out->append("null", 4);
+    _needComma = true;
+}
+
+void JsonWriter::writeBool(bool value)
+{
+    separate();
+    if (value)
+        _out->append("true", 4);
+    else
+        _out->append("false", 5);
+    _needComma = true;
+}
+
+void JsonWriter::writeInteger(qint64 value)
+{
+    // Json numbers are doubles, as in QJsonValue
+    writeDouble(double(value));
+}
+
+void JsonWriter::writeDouble(double value)
+{
+    separate();
+    appendNumber(value);
+    _needComma = true;
+}
+
+void JsonWriter::appendInteger(qint64 value)
+{
+    static const char digitPairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+
+    quint64 u = value < 0 ? 0 - quint64(value) : quint64(value);
+    while (u >= 100)
+    {
+        const int pair = int(u % 100) * 2;
+        u /= 100;
+        *--p = digitPairs[pair + 1];
+        *--p = digitPairs[pair];
+    }
+    if (u >= 10)
+    {
+        *--p = digitPairs[u * 2 + 1];
+        *--p = digitPairs[u * 2];
+    }
+    else
+    {
+        *--p = char('0' + u);
+    }
+    if (value < 0)
+        *--p = '-';
+
+    _out->append(p, int(end - p));
+}
+
+void JsonWriter::appendNumber(double value)
+{
+    if (!number::isFinite(value))
+    {
+        _out->append("null", 4); // +INF || -INF || NaN (see RFC4627#section2.4)
+        return;
+    }
+
+    // Integers up to 2^53 are exact, written without fraction or exponent
+    if (std::abs(value) < 9007199254740992.0 && value == double(qint64(value)) && !(value == 0 && std::signbit(value)))
+    {
+        appendInteger(qint64(value));
+        return;
+    }
+
+    char buf[number::BufferSize];
+    char *end = _precision >= 0 ? number::formatFixed(buf, value, _precision) : number::formatShortest(buf, value);
+    _out->append(buf, int(end - buf));
+}
+
+void JsonWriter::appendNumber(float value)
+{
+    if (_precision >= 0 || !number::isFinite(value) || (std::abs(value) < 16777216.0f && value == float(qint32(value))))
+    {
+        appendNumber(double(value));
+        return;
+    }
+
+    // Shortest digits of the float, not of the (longer) double it widens to
+    char buf[number::BufferSize];
+    char *end = number::formatShortest(buf, value);
+    _out->append(buf, int(end - buf));
+}
+
+template <typename T>
+void JsonWriter::writeNumbers(const T *values, int count)
+{
+    separate();
+    _out->append('[');
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0)
+            _out->append(',');
+        appendNumber(values[i]);
+
+        if ((i & 0xfff) == 0xfff)
+            flushIfFull();
+    }
+    _out->append(']');
+    _needComma = true;
+    flushIfFull();
+}
+
+void JsonWriter::writeArray(const double *values, int count)
+{
+    writeNumbers(values, count);
+}
+
+void JsonWriter::writeArray(const float *values, int count)
+{
+    writeNumbers(values, count);
+}
+
+void JsonWriter::writeArray(const int *values, int count)
+{
+    separate();
+    _out->append('[');
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0)
+            _out->append(',');
+        appendInteger(values[i]);
+
+        if ((i & 0xfff) == 0xfff)
+            flushIfFull();
+    }
+    _out->append(']');
+    _needComma = true;
+    flushIfFull();
+}
+
+void JsonWriter::writeString(const QString &value)
+{
+    separate();
+    appendEscaped(value);
+    _needComma = true;
+    flushIfFull();
+}
+
+void JsonWriter::writeUuid(const QUuid &value)
+{
+    // Same representation as QJsonValue::fromVariant
+    writeValue(QJsonValue::fromVariant(value));
+}
+
+void JsonWriter::appendEscaped(const QString &str)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    const QByteArray utf8 = str.toUtf8();
+    const char *begin = utf8.constData();
+    const char *end = begin + utf8.size();
+    const char *run = begin;
+
+    _out->append('"');
+    for (const char *p = begin; p != end; ++p)
+    {
+        const uchar c = static_cast<uchar>(*p);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        // Flush the unescaped run
+        _out->append(run, int(p - run));
+        run = p + 1;
+
+        switch (c)
+        {
+        case '"': _out->append("\\\"", 2); break;
+        case '\\': _out->append("\\\\", 2); break;
+        case '\b': _out->append("\\b", 2); break;
+        case '\f': _out->append("\\f", 2); break;
+        case '\n': _out->append("\\n", 2); break;
+        case '\r': _out->append("\\r", 2); break;
+        case '\t': _out->append("\\t", 2); break;
+        default:
+            _out->append("\\u00", 4);
+            _out->append(hex[c >> 4]);
+            _out->append(hex[c & 0xf]);
+            break;
+        }
+    }
+    _out->append(run, int(end - run));
+    _out->append('"');
+}
@@ -0,0 +1,90 @@
+/****************************************************************************
+
+ Copyright (c) 2014, Hans Robeers
+ All rights reserved.
+
+ BSD 2-Clause License
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+   * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+****************************************************************************/
+
+//
+// Private JenSON header, not part of the public API.
+//
+
+#ifndef JENSON_WRITER_H
+#define JENSON_WRITER_H
+
+#include <QByteArray>
+#include "jenson_format.h"
+
+class QIODevice;
+
+namespace jenson
+{
+    //
+    // Forward-only compact UTF-8 Json writer.
+    // Writes into a QByteArray directly or through a buffer into a QIODevice.
+    //
+
+    class JsonWriter : public AbstractWriter
+    {
+    private:
+        QByteArray *_out;
+        QIODevice *_device;
+        QByteArray _buffer;
+        qint64 _flushed;        // Bytes handed to the device
+        int _start;             // Initial size of *_out
+        bool _needComma;
+        bool _error;
+
+        void separate();
+        void flushIfFull();
+        void appendEscaped(const QString &str);
+        void appendInteger(qint64 value);
+        void appendNumber(double value);
+        void appendNumber(float value);
+
+        template <typename T> void writeNumbers(const T *values, int count);
+
+    public:
+        explicit JsonWriter(QByteArray *out);
+        explicit JsonWriter(QIODevice *device);
+        ~JsonWriter();
+
+        virtual void beginObject() override;
+        virtual void endObject() override;
+        virtual void beginArray() override;
+        virtual void endArray() override;
+        virtual void writeKey(const QString &key) override;
+
+        virtual void writeNull() override;
+        virtual void writeBool(bool value) override;
+        virtual void writeInteger(qint64 value) override;
+        virtual void writeDouble(double value) override;
+        virtual void writeString(const QString &value) override;
+        virtual void writeUuid(const QUuid &value) override;
+
+        virtual void writeArray(const double *values, int count) override;
+        virtual void writeArray(const float *values, int count) override;
+        virtual void writeArray(const int *values, int count) override;
+
+        // Writes the buffered output to the device, returns false on write errors
+        virtual bool flush() override;
+        virtual qint64 offset() const override { return _flushed + _out->size() - _start; }
+    };
+}
+
+#endif // JENSON_WRITER_H
@@ -25,8 +25,25 @@
 
 #include <memory>
 #include <QObject>
+#include <QThread>
 
+#ifdef QPTR_IMMEDIATE_DELETE
+// Deletes objects of the deleting thread (or of no thread) right away with all their children, no event loop
+// needed. Objects living in another thread can not be deleted from here and still use deleteLater().
+struct QObjectDeleter
+{
+    void operator()(QObject* ptr)
+    {
+        QThread *thread = ptr->thread();
+        if (!thread || thread == QThread::currentThread())
+            delete ptr;
+        else
+            ptr->deleteLater();
+    }
+};
+#else
 struct QObjectDeleter { void operator()(QObject* ptr) { ptr->deleteLater(); } };
+#endif
 
 template <typename T>
 using qunique_ptr = std::unique_ptr<T, QObjectDeleter>;
@@ -24,11 +24,19 @@
 #include "submodules/qtestrunner/qtestrunner.hpp"
 
 #include <QJsonArray>
+#include <QJsonDocument>
+#include <QBuffer>
+#include <QFile>
+#include <QFuture>
+#include <QTemporaryDir>
+#include <QThread>
+#include <cmath>
+#include <limits>
 #include <memory>
 
 void JensonTests::initTestCase()
 {
-    OBJ_CNT.enabled = true;
+    objectCounter().enabled = true;
 }
 
 void JensonTests::testSerialization()
@@ -176,6 +184,1204 @@ void JensonTests::testOnDeserialized()
     QCOMPARE(deserial->_onDeserializedCalled, true);
 }
 
+void JensonTests::testStreamingSerialization()
+{
+    Testobject p(2, 3);
+    p.setOptionalStr("Escaped \"string\"\n\ttest");
+    p.nestedObj()->setSomeString("This is a nested object");
+
+    QJsonObject obj = jenson::JenSON::serialize(&p);
+
+    // Serialize to a QByteArray
+    QByteArray json;
+    jenson::JenSON::serialize(&p, &json);
+    QCOMPARE(QJsonDocument::fromJson(json).object(), obj);
+
+    // Serialize to a QIODevice
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    jenson::JenSON::serialize(&p, &buffer);
+    QCOMPARE(buffer.data(), json);
+
+    // Custom serializers are bridged
+    CustomContainer cont;
+    QByteArray customJson;
+    jenson::JenSON::serialize(&cont, &customJson);
+    QCOMPARE(QJsonDocument::fromJson(customJson).object(), jenson::JenSON::serialize(&cont));
+}
+
+void JensonTests::testStreamingDeserialization()
+{
+    Testobject p(2, 3);
+    p.setOptionalStr("Escaped \"string\"\n\ttest \u00e9");
+    p.nestedObj()->setSomeString("This is a nested object");
+
+    QByteArray json;
+    jenson::JenSON::serialize(&p, &json);
+
+    //
+    // Deserialize from a QByteArray
+    //
+    sptr<QObject> o = jenson::JenSON::deserializeFrom(json);
+    QCOMPARE(o->metaObject()->className(), p.metaObject()->className());
+
+    Testobject *to = (Testobject*)o.get();
+    QCOMPARE(to->x(), p.x());
+    QCOMPARE(to->y(), p.y());
+    QCOMPARE(to->optionalStr(), p.optionalStr());
+    QCOMPARE(to->singleProp()->someUuid(), p.singleProp()->someUuid());
+    QCOMPARE(to->nestedObj()->someString(), p.nestedObj()->someString());
+    QCOMPARE(to->internalList()->first()->someUuid(), p.internalList()->first()->someUuid());
+    QVERIFY(to->internalList()->at(0)->metaObject()->className() != to->internalList()->at(1)->metaObject()->className());
+    QCOMPARE(to->intList().last(), p.intList().last());
+
+    //
+    // Deserialize from a QIODevice
+    //
+    QBuffer buffer(&json);
+    buffer.open(QIODevice::ReadOnly);
+    sptr<QObject> fromDevice = jenson::JenSON::deserializeFrom(&buffer);
+    QCOMPARE(((Testobject*)fromDevice.get())->optionalStr(), p.optionalStr());
+
+    //
+    // Nested custom serializers are bridged
+    //
+    CustomContainer cont;
+    QByteArray customJson;
+    jenson::JenSON::serialize(&cont, &customJson);
+    sptr<QObject> dCont = jenson::JenSON::deserializeFrom(customJson);
+    QCOMPARE(((CustomContainer*)dCont.get())->nested()->x, (cont.nested()->x / 2) + 5);
+
+    //
+    // Failures
+    //
+    QString errorMsg;
+    QVERIFY(jenson::JenSON::deserializeFrom(json.left(json.size() / 2), &errorMsg) == 0);
+    QVERIFY(errorMsg.contains("parse error"));
+
+    QString errorMsg2;
+    QJsonObject pObj = jenson::JenSON::serialize(&p)[jenson::JenSON::toSerialName(p.metaObject()->className())].toObject();
+    pObj.remove("x");
+    QJsonObject missingX;
+    missingX.insert(jenson::JenSON::toSerialName(p.metaObject()->className()), pObj);
+    QVERIFY(jenson::JenSON::deserializeFrom(QJsonDocument(missingX).toJson(), &errorMsg2) == 0);
+    QVERIFY(errorMsg2.contains("x"));
+
+    QTR_ASSERT_THROW(jenson::JenSON::deserializeFrom(QByteArray("{\"NotRegisteredClass\":{}}")), jenson::SerializationException)
+}
+
+void JensonTests::testCborSerialization()
+{
+    Testobject p(2.5, 3);
+    p.setOptionalStr("This is a Testobject");
+    p.nestedObj()->setSomeString("This is a nested object");
+
+    QByteArray cbor;
+#ifdef JENSON_CBOR
+    jenson::JenSON::serialize(&p, &cbor, jenson::JenSON::Cbor);
+
+    QByteArray json;
+    jenson::JenSON::serialize(&p, &json);
+    QVERIFY(cbor.size() < json.size());
+
+    sptr<QObject> o = jenson::JenSON::deserializeFrom(cbor, jenson::JenSON::Cbor);
+    QCOMPARE(o->metaObject()->className(), p.metaObject()->className());
+
+    Testobject *to = (Testobject*)o.get();
+    QCOMPARE(to->x(), p.x());
+    QCOMPARE(to->y(), p.y());
+    QCOMPARE(to->optionalStr(), p.optionalStr());
+    QCOMPARE(to->singleProp()->someUuid(), p.singleProp()->someUuid());
+    QCOMPARE(to->nestedObj()->someString(), p.nestedObj()->someString());
+    QCOMPARE(to->internalList()->first()->someUuid(), p.internalList()->first()->someUuid());
+    QCOMPARE(to->intList().last(), p.intList().last());
+
+    // Integral doubles are written as integers, except -0.0
+    Testobject negativeZero(-0.0, 3);
+    QByteArray negativeZeroCbor;
+    jenson::JenSON::serialize(&negativeZero, &negativeZeroCbor, jenson::JenSON::Cbor);
+    sptr<QObject> dNegativeZero = jenson::JenSON::deserializeFrom(negativeZeroCbor, jenson::JenSON::Cbor);
+    QVERIFY(std::signbit(((Testobject*)dNegativeZero.get())->x()));
+
+    // Uuids in chunked byte strings, {"sProp": {"someUuid": 37(_ h'..', h'..')}}
+    const QUuid uuid = QUuid::createUuid();
+    const QByteArray rfc4122 = uuid.toRfc4122();
+    const QByteArray chunkedUuid = QByteArray::fromHex("a1657350726f70a168736f6d6555756964d8255f48") + rfc4122.left(8) +
+            QByteArray::fromHex("48") + rfc4122.mid(8) + QByteArray::fromHex("ff");
+    sptr<QObject> dChunked = jenson::JenSON::deserializeFrom(chunkedUuid, jenson::JenSON::Cbor);
+    QCOMPARE(((SingleProperty*)dChunked.get())->someUuid(), uuid);
+
+    // Custom serializers are bridged through Json
+    CustomContainer cont;
+    QByteArray customCbor;
+    jenson::JenSON::serialize(&cont, &customCbor, jenson::JenSON::Cbor);
+    sptr<QObject> dCont = jenson::JenSON::deserializeFrom(customCbor, jenson::JenSON::Cbor);
+    QCOMPARE(((CustomContainer*)dCont.get())->nested()->x, (cont.nested()->x / 2) + 5);
+
+    // Device output is the same, failed device writes are reported instead of truncating the output
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    jenson::JenSON::serialize(&p, &buffer, jenson::JenSON::Cbor);
+    QCOMPARE(buffer.data(), cbor);
+
+    QByteArray readOnlyData;
+    QBuffer readOnly(&readOnlyData);
+    readOnly.open(QIODevice::ReadOnly);
+    QTR_ASSERT_THROW(jenson::JenSON::serialize(&p, &readOnly, jenson::JenSON::Cbor), jenson::SerializationException)
+#else
+    QTR_ASSERT_THROW(jenson::JenSON::serialize(&p, &cbor, jenson::JenSON::Cbor), jenson::SerializationException)
+#endif
+}
+
+void JensonTests::testBatchSerialization()
+{
+    QList<std::shared_ptr<Testobject>> objects;
+    QList<const Testobject*> constObjects;
+    for (int i = 0; i < 100; i++)
+    {
+        objects.append(std::shared_ptr<Testobject>(new Testobject(i, -i)));
+        constObjects.append(objects.last().get());
+    }
+
+    QJsonArray array = jenson::JenSON::serializeMany(constObjects);
+    QCOMPARE(array.count(), objects.count());
+
+    std::vector<sptr<Testobject>> deserialized = jenson::JenSON::deserializeMany<Testobject>(&array);
+    QCOMPARE((int)deserialized.size(), objects.count());
+
+    // Input order and thread affinity
+    for (int i = 0; i < objects.count(); i++)
+    {
+        QCOMPARE(deserialized[i]->x(), qreal(i));
+        QCOMPARE(deserialized[i]->singleProp()->someUuid(), objects[i]->singleProp()->someUuid());
+        QCOMPARE(deserialized[i]->thread(), QThread::currentThread());
+        QCOMPARE(deserialized[i]->nestedObj()->thread(), QThread::currentThread());
+    }
+
+    // Failed items are reported
+    QString errorMsg;
+    array.append(QJsonObject());
+    std::vector<sptr<QObject>> partial = jenson::JenSON::deserializeMany(&array, &errorMsg);
+    QVERIFY(partial.back() == nullptr);
+    QVERIFY(errorMsg.contains("Item 100"));
+    QTR_ASSERT_THROW(jenson::JenSON::deserializeMany(&array), jenson::SerializationException)
+}
+
+void JensonTests::testTypeHandles()
+{
+    jenson::JenSON::TypeHandle handle = jenson::JenSON::typeHandle(&Testobject::staticMetaObject);
+    QVERIFY(handle >= 0);
+    QVERIFY(handle < jenson::JenSON::typeCount());
+    QCOMPARE(jenson::JenSON::typeHandle(QString("Testobject")), handle);
+    QCOMPARE(jenson::JenSON::typeHandleOfSerialName("tObj"), handle);
+    QCOMPARE(jenson::JenSON::className(handle), QString("Testobject"));
+    QCOMPARE(jenson::JenSON::serialName(handle), QString("tObj"));
+
+    // Handles are dense and unique
+    QVERIFY(jenson::JenSON::typeHandle(&SingleProperty::staticMetaObject) != handle);
+
+    // Unregistered classes
+    QCOMPARE(jenson::JenSON::typeHandle(&QObject::staticMetaObject), -1);
+    QCOMPARE(jenson::JenSON::typeHandle(QString("Unregistered")), -1);
+    QCOMPARE(jenson::JenSON::typeHandleOfSerialName("Unregistered"), -1);
+    QCOMPARE(jenson::JenSON::serialName(-1), QString());
+
+    // Name conversions are backed by the same index
+    QCOMPARE(jenson::JenSON::toSerialName("Testobject*"), QString("tObj"));
+    QCOMPARE(jenson::JenSON::toClassName("tObj"), QString("Testobject"));
+    QCOMPARE(jenson::JenSON::toClassName("Unregistered"), QString("Unregistered"));
+}
+
+void JensonTests::testTypedFields()
+{
+    QVERIFY(jenson::fieldsOf<TypedObject>() != nullptr);
+    QVERIFY(jenson::fieldsOf<SingleProperty>() == nullptr);
+
+    const jenson::FieldList &fields = TypedObject::jensonFields();
+    QCOMPARE(fields.count(), 2);
+    QCOMPARE(fields.find("x")->kind(), jenson::IField::Number);
+    QCOMPARE(fields.find("nestedObj")->kind(), jenson::IField::Object);
+    QVERIFY(fields.find("y") == nullptr);
+
+    // Typed and QVariant properties serialize alike
+    TypedObject obj;
+    obj.setx(2.5);
+    obj.sety(3.5);
+    QJsonObject json = jenson::JenSON::serialize(&obj);
+    QJsonObject props = json.value("tTyped").toObject();
+    QCOMPARE(props.value("x").toDouble(), 2.5);
+    QCOMPARE(props.value("y").toDouble(), 3.5);
+    QVERIFY(props.value("nestedObj").isObject());
+
+    sptr<TypedObject> ds = jenson::JenSON::deserialize<TypedObject>(&json);
+    QCOMPARE(ds->x(), 2.5);
+    QCOMPARE(ds->y(), 3.5);
+    QCOMPARE(ds->nestedObj()->parent(), ds.get());
+
+    // Values of another Json type fall back to the QVariant conversions
+    props.insert("x", QString("4.5"));
+    json.insert("tTyped", props);
+    ds = jenson::JenSON::deserialize<TypedObject>(&json);
+    QCOMPARE(ds->x(), 4.5);
+
+    // Streaming uses the same fields
+    QByteArray bytes;
+    jenson::JenSON::serialize(&obj, &bytes);
+    sptr<QObject> streamed = jenson::JenSON::deserializeFrom(bytes);
+    QCOMPARE(qobject_cast<TypedObject*>(streamed.get())->x(), 2.5);
+}
+
+void JensonTests::testArenaAllocation()
+{
+    ArenaNode node;
+    ArenaLeaf *leaf = new ArenaLeaf();
+    leaf->setParent(&node);
+    leaf->setvalue(1.5);
+    node.setleaf(leaf);
+    QVERIFY(!jenson::Arena::isArenaAllocated(leaf));
+
+    QJsonObject json = jenson::JenSON::serialize(&node);
+
+    std::vector<sptr<ArenaNode>> nodes;
+    {
+        jenson::Arena arena(1024);
+        jenson::Arena::Scope scope(&arena);
+        QCOMPARE(jenson::Arena::current(), &arena);
+
+        for (int i = 0; i < 100; i++)
+            nodes.push_back(jenson::JenSON::deserialize<ArenaNode>(&json));
+
+        QVERIFY(arena.chunkCount() > 1);
+        QVERIFY(arena.chunkCount() < 100);
+    }
+    QVERIFY(jenson::Arena::current() == nullptr);
+
+    // The graphs outlive the arena
+    foreach (const sptr<ArenaNode> &dNode, nodes)
+    {
+        QVERIFY(jenson::Arena::isArenaAllocated(dNode.get()));
+        QVERIFY(jenson::Arena::isArenaAllocated(dNode->leaf()));
+        QCOMPARE(dNode->leaf()->value(), 1.5);
+    }
+}
+
+void JensonTests::testDeserializeInto()
+{
+    Testobject source(4, 5);
+    source.setOptionalStr("updated");
+    source.nestedObj()->setSomeString("updated nested");
+    QJsonObject json = jenson::JenSON::serialize(&source);
+
+    Testobject target(1, 2);
+    Nestedobject *nested = target.nestedObj();
+    SingleProperty *sProp = target.singleProp();
+
+    // Wrapped json
+    jenson::JenSON::deserializeInto(&target, &json);
+    QCOMPARE(target.x(), qreal(4));
+    QCOMPARE(target.y(), qreal(5));
+    QCOMPARE(target.optionalStr(), QString("updated"));
+
+    // Nested children are updated in place
+    QCOMPARE(target.nestedObj(), nested);
+    QCOMPARE(target.singleProp(), sProp);
+    QCOMPARE(nested->someString(), QString("updated nested"));
+    QCOMPARE(sProp->someUuid(), source.singleProp()->someUuid());
+
+    // Unwrapped json
+    QJsonObject props = json.value("tObj").toObject();
+    props.insert("x", 6);
+    jenson::JenSON::deserializeInto(&target, &props);
+    QCOMPARE(target.x(), qreal(6));
+    QCOMPARE(target.nestedObj(), nested);
+
+    // onDeserialized() runs once on the target
+    OnDeserialized onDeserial;
+    QJsonObject onDeserialJson = jenson::JenSON::serialize(&onDeserial);
+    OnDeserialized onDeserialTarget;
+    QString errorMsg;
+    QVERIFY(jenson::JenSON::deserializeInto(&onDeserialTarget, &onDeserialJson, &errorMsg));
+    QVERIFY(onDeserialTarget._onDeserializedCalled);
+    QCOMPARE(onDeserialTarget.someUuid(), onDeserial.someUuid());
+
+    // Custom serializers cannot update in place
+    CustomSerializable custom;
+    QJsonObject customJson = jenson::JenSON::serialize(&custom);
+    QVERIFY(!jenson::JenSON::deserializeInto(&custom, &customJson, &errorMsg));
+    QTR_ASSERT_THROW(jenson::JenSON::deserializeInto(&custom, &customJson), jenson::SerializationException)
+}
+
+void JensonTests::testDeltaSerialization()
+{
+    TrackedObject source;
+    TrackedObject replica;
+    jenson::ChangeTracker tracker(&source);
+    QVERIFY(tracker.isTracked(source.child()));
+
+    // Without changes nothing is sent
+    quint64 since = tracker.revision();
+    QJsonObject delta = jenson::JenSON::serializeDelta(&source, &tracker, since);
+    QJsonObject props = delta.value("tTracked").toObject();
+    QVERIFY(props.isEmpty());
+
+    // Properties without NOTIFY signal are sent once when their value changed
+    source.setuntracked(0.5);
+    delta = jenson::JenSON::serializeDelta(&source, &tracker, since);
+    props = delta.value("tTracked").toObject();
+    QCOMPARE(props.keys(), QStringList() << "untracked");
+    jenson::JenSON::applyDelta(&replica, &delta);
+    QCOMPARE(replica.untracked(), 0.5);
+
+    since = tracker.revision();
+    delta = jenson::JenSON::serializeDelta(&source, &tracker, since);
+    QVERIFY(delta.value("tTracked").toObject().isEmpty());
+
+    // Changed properties and subtrees
+    source.seta(1.5);
+    source.seta(1.5); // Unchanged value, no notification
+    source.child()->setvalue(2.5);
+    QCOMPARE(tracker.revision(), since + 2);
+
+    delta = jenson::JenSON::serializeDelta(&source, &tracker, since);
+    props = delta.value("tTracked").toObject();
+    QVERIFY(props.contains("a"));
+    QVERIFY(!props.contains("b"));
+    QCOMPARE(props.value("child").toObject().keys(), QStringList() << "value");
+
+    TrackedChild *replicaChild = replica.child();
+    jenson::JenSON::applyDelta(&replica, &delta);
+    QCOMPARE(replica.a(), 1.5);
+    QCOMPARE(replica.b(), QString());
+    QCOMPARE(replica.child(), replicaChild);
+    QCOMPARE(replicaChild->value(), 2.5);
+
+    // Only changes after since
+    since = tracker.revision();
+    source.setb("b");
+    delta = jenson::JenSON::serializeDelta(&source, &tracker, since);
+    props = delta.value("tTracked").toObject();
+    QVERIFY(props.contains("b"));
+    QVERIFY(!props.contains("a"));
+    QVERIFY(!props.contains("child"));
+
+    // Replaced children are sent in full, retracked and deserialized fresh
+    since = tracker.revision();
+    TrackedChild *newChild = new TrackedChild();
+    newChild->setParent(&source);
+    newChild->setvalue(3.5);
+    source.setchild(newChild);
+    QVERIFY(tracker.isTracked(newChild));
+
+    delta = jenson::JenSON::serializeDelta(&source, &tracker, since);
+    props = delta.value("tTracked").toObject();
+    QCOMPARE(props.value("child").toObject().keys(), QStringList() << "tChild");
+    jenson::JenSON::applyDelta(&replica, &delta);
+    QVERIFY(replica.child() != replicaChild);
+    QCOMPARE(replica.child()->value(), 3.5);
+
+    since = tracker.revision();
+    newChild->setvalue(4.5);
+    QVERIFY(tracker.subtreeRevision(&source) > since);
+    delta = jenson::JenSON::serializeDelta(&source, &tracker, since);
+    jenson::JenSON::applyDelta(&replica, &delta);
+    QCOMPARE(replica.child()->value(), 4.5);
+    QCOMPARE(replica.b(), QString("b"));
+
+    // Destroyed objects take their tracked subtree along, also children with another QObject parent
+    TrackedObject *root = new TrackedObject();
+    TrackedChild *orphan = root->child();
+    orphan->setParent(nullptr);
+    jenson::ChangeTracker rootTracker(root);
+    QVERIFY(rootTracker.isTracked(orphan));
+    delete root;
+    QVERIFY(!rootTracker.root());
+    QVERIFY(!rootTracker.isTracked(orphan));
+    delete orphan;
+}
+
+void JensonTests::testLazyDeserialization()
+{
+    LazyHolder holder;
+    holder.setx(1.5);
+    Nestedobject *nested = new Nestedobject();
+    nested->setParent(&holder);
+    nested->setSomeString("lazy");
+    holder.setlazyNested(nested);
+    QVERIFY(!holder.isPending());
+
+    QJsonObject json = jenson::JenSON::serialize(&holder);
+    QJsonObject nestedJson = json.value("lHolder").toObject().value("lazyNested").toObject();
+
+    // The nested object is deserialized on first use
+    sptr<LazyHolder> ds = jenson::JenSON::deserialize<LazyHolder>(&json);
+    QCOMPARE(ds->x(), 1.5);
+    QVERIFY(ds->isPending());
+
+    // Unmaterialized values serialize from the stored Json
+    QJsonObject reserialized = jenson::JenSON::serialize(ds.get());
+    QVERIFY(ds->isPending());
+    QCOMPARE(reserialized.value("lHolder").toObject().value("lazyNested").toObject(), nestedJson);
+
+    QCOMPARE(ds->lazyNested()->someString(), QString("lazy"));
+    QCOMPARE(ds->lazyNested()->parent(), ds.get());
+    QVERIFY(!ds->isPending());
+
+    // Explicit materialization, also through the streaming path
+    QByteArray bytes;
+    jenson::JenSON::serialize(&holder, &bytes);
+    sptr<QObject> streamed = jenson::JenSON::deserializeFrom(bytes);
+    LazyHolder *sHolder = qobject_cast<LazyHolder*>(streamed.get());
+    QVERIFY(sHolder->isPending());
+    jenson::JenSON::materialize(sHolder);
+    QVERIFY(!sHolder->isPending());
+    QCOMPARE(sHolder->lazyNested()->someString(), QString("lazy"));
+
+    // The streaming reader skips the nested value without decoding it, strings may contain brackets
+    const QByteArray raw("{\"lHolder\":{\"lazyNested\":{\"someString\":\"} ] \\\"{\"},\"x\":2.5}}");
+    QBuffer device;
+    device.setData(raw);
+    device.open(QIODevice::ReadOnly);
+    sptr<QObject> fromBytes = jenson::JenSON::deserializeFrom(raw);
+    sptr<QObject> fromDevice = jenson::JenSON::deserializeFrom(&device);
+    foreach (QObject *obj, QList<QObject*>() << fromBytes.get() << fromDevice.get())
+    {
+        LazyHolder *rHolder = qobject_cast<LazyHolder*>(obj);
+        QCOMPARE(rHolder->x(), 2.5);
+        QVERIFY(rHolder->isPending());
+        QCOMPARE(jenson::JenSON::serialize(rHolder).value("lHolder").toObject().value("lazyNested").toObject()
+                 .value("someString").toString(), QString("} ] \"{"));
+        QVERIFY(rHolder->isPending());
+        QCOMPARE(rHolder->lazyNested()->someString(), QString("} ] \"{"));
+    }
+
+    // Failed getters return nullptr and keep the Json, materialize reports the error
+    QJsonObject wrongNested;
+    wrongNested.insert("lHolder", QJsonObject()); // Not a Nestedobject
+    QJsonObject wrongProps = json.value("lHolder").toObject();
+    wrongProps.insert("lazyNested", wrongNested);
+    QJsonObject wrongJson;
+    wrongJson.insert("lHolder", wrongProps);
+
+    sptr<LazyHolder> wrong = jenson::JenSON::deserialize<LazyHolder>(&wrongJson);
+    QVERIFY(wrong->lazyNested() == nullptr);
+    QVERIFY(wrong->isPending());
+    QString errorMsg;
+    QVERIFY(!jenson::JenSON::materialize(wrong.get(), &errorMsg));
+    QVERIFY(errorMsg.contains("lazyNested"));
+    QTR_ASSERT_THROW(jenson::JenSON::materialize(wrong.get()), jenson::SerializationException)
+    QCOMPARE(jenson::JenSON::serialize(wrong.get()), wrongJson);
+}
+
+void JensonTests::testNumericArrays()
+{
+    NumericArrays arrays;
+    arrays.setdoubles(QVector<double>() << 0.1 << -2.5e-300 << 1e21 << 3);
+    arrays.setfloats(QVector<float>() << 0.1f << -7.25f);
+    arrays.setints(QVector<int>() << 0 << -1 << 2147483647 << -2147483647 - 1);
+
+    // Plain Json number arrays
+    QJsonObject json = jenson::JenSON::serialize(&arrays);
+    QJsonObject props = json.value("nArrays").toObject();
+    QCOMPARE(props.value("ints").toArray(), QJsonArray() << 0 << -1 << 2147483647 << -2147483647.0 - 1);
+    QCOMPARE(props.value("doubles").toArray().at(0).toDouble(), 0.1);
+
+    sptr<NumericArrays> ds = jenson::JenSON::deserialize<NumericArrays>(&json);
+    QCOMPARE(ds->doubles(), arrays.doubles());
+    QCOMPARE(ds->floats(), arrays.floats());
+    QCOMPARE(ds->ints(), arrays.ints());
+
+    // Streaming writes the same Json
+    QByteArray bytes;
+    jenson::JenSON::serialize(&arrays, &bytes);
+    QCOMPARE(QJsonDocument::fromJson(bytes).object(), json);
+
+    sptr<QObject> streamed = jenson::JenSON::deserializeFrom(bytes);
+    NumericArrays *sArrays = qobject_cast<NumericArrays*>(streamed.get());
+    QCOMPARE(sArrays->doubles(), arrays.doubles());
+    QCOMPARE(sArrays->floats(), arrays.floats());
+    QCOMPARE(sArrays->ints(), arrays.ints());
+
+    // Non-integral values do not fit an int array
+    QString errorMsg;
+    props.insert("ints", QJsonArray() << 1 << 1.5);
+    json.insert("nArrays", props);
+    QVERIFY(jenson::JenSON::deserialize<NumericArrays>(&json, &errorMsg) == nullptr);
+    QVERIFY(jenson::JenSON::deserializeFrom(QJsonDocument(json).toJson(), &errorMsg) == nullptr);
+
+#ifdef JENSON_CBOR
+    // Packed little-endian typed arrays
+    QByteArray cbor;
+    jenson::JenSON::serialize(&arrays, &cbor, jenson::JenSON::Cbor);
+    QVERIFY(cbor.size() < bytes.size());
+    sptr<QObject> fromCbor = jenson::JenSON::deserializeFrom(cbor, jenson::JenSON::Cbor);
+    NumericArrays *cArrays = qobject_cast<NumericArrays*>(fromCbor.get());
+    QCOMPARE(cArrays->doubles(), arrays.doubles());
+    QCOMPARE(cArrays->floats(), arrays.floats());
+    QCOMPARE(cArrays->ints(), arrays.ints());
+#endif
+}
+
+void JensonTests::testInputScanning()
+{
+    //
+    // Strings with special characters at every offset of the 16 and 32 byte scan blocks
+    //
+    for (int offset = 0; offset < 70; offset++)
+    {
+        const QString plain(offset, QChar('a'));
+        const QStringList tails = QStringList() << "\"" << "\\" << "\n" << "\u00e9" << "\u4e2d" << "";
+
+        foreach (const QString &tail, tails)
+        {
+            Testobject p(offset, 3);
+            p.setOptionalStr(plain + tail + plain);
+
+            // Indented Json, the whitespace runs are scanned in bulk as well
+            QJsonDocument doc(jenson::JenSON::serialize(&p));
+            QByteArray json = doc.toJson(QJsonDocument::Indented);
+
+            sptr<QObject> o = jenson::JenSON::deserializeFrom(json);
+            QCOMPARE(((Testobject*)o.get())->optionalStr(), p.optionalStr());
+            QCOMPARE(((Testobject*)o.get())->x(), p.x());
+        }
+    }
+
+    //
+    // Strings and whitespace spanning the chunks read from a device
+    //
+    Testobject p(1, 2);
+    p.setOptionalStr(QString(100000, QChar('b')) + "\"" + QString(70000, QChar(0x00e9)));
+    QByteArray json;
+    jenson::JenSON::serialize(&p, &json);
+    json.replace(",", QByteArray(",") + QByteArray(70000, ' '));
+
+    QBuffer buffer(&json);
+    buffer.open(QIODevice::ReadOnly);
+    sptr<QObject> fromDevice = jenson::JenSON::deserializeFrom(&buffer);
+    QCOMPARE(((Testobject*)fromDevice.get())->optionalStr(), p.optionalStr());
+
+    //
+    // Unescaped control characters are rejected
+    //
+    QString errorMsg;
+    QByteArray invalid = json;
+    invalid.replace("bbbb\\\"", "bbb\t\\\"");
+    QVERIFY(jenson::JenSON::deserializeFrom(invalid, &errorMsg) == 0);
+    QVERIFY(!errorMsg.isEmpty());
+}
+
+void JensonTests::testNumberFormatting()
+{
+    PreciseValues values;
+    values.setshortest(0.1 + 0.2);
+    values.setrounded(3.14159);
+    values.setpoints(QVector<double>() << 1.23456 << -0.0004 << 2);
+    values.setfloats(QVector<float>() << 0.1f << 1e30f);
+
+    //
+    // Shortest representation that reads back exactly, fixed precision where declared
+    //
+    QByteArray bytes;
+    jenson::JenSON::serialize(&values, &bytes);
+    QVERIFY(bytes.contains("\"shortest\":0.30000000000000004"));
+    QVERIFY(bytes.contains("\"rounded\":3.14,"));
+    QVERIFY(bytes.contains("\"points\":[1.235,0,2]"));
+    QVERIFY(bytes.contains("\"floats\":[0.1,1e+30]"));
+
+    sptr<QObject> streamed = jenson::JenSON::deserializeFrom(bytes);
+    PreciseValues *sValues = qobject_cast<PreciseValues*>(streamed.get());
+    QCOMPARE(sValues->shortest(), values.shortest());
+    QCOMPARE(sValues->rounded(), 3.14);
+    QCOMPARE(sValues->points(), QVector<double>() << 1.235 << 0 << 2);
+    QCOMPARE(sValues->floats(), values.floats());
+
+    // The Json objects are rounded the same way
+    QJsonObject json = jenson::JenSON::serialize(&values);
+    QCOMPARE(QJsonDocument::fromJson(bytes).object(), json);
+
+    //
+    // Parsing agrees with QJsonDocument
+    //
+    const QList<QByteArray> numbers = QList<QByteArray>() << "0" << "-0.5e-3" << "1E+2" << "123456789012345678901234567890"
+                                                          << "2.2250738585072014e-308" << "0.1" << "9007199254740993" << "1e23";
+    foreach (const QByteArray &number, numbers)
+    {
+        QByteArray text = "{\"pValues\":{\"shortest\":" + number + ",\"rounded\":0,\"points\":[" + number + "],\"floats\":[]}}";
+        sptr<QObject> o = jenson::JenSON::deserializeFrom(text);
+        const double expected = QJsonDocument::fromJson("[" + number + "]").array().at(0).toDouble();
+        QCOMPARE(qobject_cast<PreciseValues*>(o.get())->shortest(), expected);
+        QCOMPARE(qobject_cast<PreciseValues*>(o.get())->points().first(), expected);
+    }
+
+    // Numbers outside the Json grammar are rejected
+    QString errorMsg;
+    QVERIFY(jenson::JenSON::deserializeFrom(QByteArray("{\"pValues\":{\"shortest\":01}}"), &errorMsg) == 0);
+    QVERIFY(jenson::JenSON::deserializeFrom(QByteArray("{\"pValues\":{\"shortest\":1.}}"), &errorMsg) == 0);
+
+    //
+    // NaN and +-Inf are written as null (also in -ffast-math builds)
+    //
+    const double inf = std::numeric_limits<double>::infinity();
+    foreach (double special, QList<double>() << std::numeric_limits<double>::quiet_NaN() << inf << -inf)
+    {
+        NonFiniteValues nonFinite;
+        nonFinite.setnumber(special);
+        nonFinite.setsingle(float(special));
+        nonFinite.setdoubles(QVector<double>() << special << 1.5);
+        nonFinite.setfloats(QVector<float>() << float(special) << 0.1f);
+
+        QByteArray nonFiniteBytes;
+        jenson::JenSON::serialize(&nonFinite, &nonFiniteBytes);
+        QCOMPARE(nonFiniteBytes, QByteArray("{\"nfValues\":{\"number\":null,\"single\":null,"
+                                            "\"doubles\":[null,1.5],\"floats\":[null,0.1]}}"));
+
+        QJsonDocument nonFiniteJson(jenson::JenSON::serialize(&nonFinite));
+        QCOMPARE(nonFiniteJson.toJson(QJsonDocument::Compact),
+                 QJsonDocument::fromJson(nonFiniteBytes).toJson(QJsonDocument::Compact));
+    }
+}
+
+void JensonTests::testAllocationStats()
+{
+    Testobject p(1, 2);
+    QJsonObject json = jenson::JenSON::serialize(&p);
+
+    jenson::AllocationScope outer;
+    {
+        jenson::AllocationScope scope;
+        sptr<QObject> o = jenson::JenSON::deserializeToObject(&json);
+        QVERIFY(scope.total().allocations > 0);
+        QVERIFY(scope.total().allocatedBytes >= scope.total().allocations);
+
+        if (jenson::AllocationScope::isInstrumented())
+        {
+            // Testobject, its nested object, the single property and 3 list items
+            QCOMPARE(scope.total().objects, quint64(6));
+            QCOMPARE(scope.stats("Testobject").objects, quint64(1));
+            QCOMPARE(scope.stats("SingleProperty").objects, quint64(3));
+            QCOMPARE(scope.stats("DerivedSingleProperty").objects, quint64(1));
+            QVERIFY(scope.stats("Testobject").variants > 0);
+            QVERIFY(scope.stats("Testobject").jsonValues > 0);
+            QVERIFY(scope.stats("Testobject").allocations > 0);
+            QVERIFY(scope.perClass().contains("Nestedobject"));
+
+            // The streaming path is counted the same way
+            QByteArray bytes;
+            jenson::JenSON::serialize(&p, &bytes);
+            jenson::AllocationScope streamScope;
+            sptr<QObject> streamed = jenson::JenSON::deserializeFrom(bytes);
+            QCOMPARE(streamScope.total().objects, quint64(6));
+        }
+        else
+        {
+            QCOMPARE(scope.total().objects, quint64(0));
+        }
+    }
+
+    // Nested scopes add up in the enclosing scope
+    QVERIFY(outer.total().allocations > 0);
+    if (jenson::AllocationScope::isInstrumented())
+        QCOMPARE(outer.stats("Testobject").objects, quint64(2));
+
+    // Items handed to pool threads are counted in the scope of the calling thread
+    if (jenson::AllocationScope::isInstrumented())
+    {
+        jenson::AllocationScope parallelScope;
+        jenson::JenSON::setParallelThreshold(2);
+        sptr<QObject> parallel = jenson::JenSON::deserializeToObject(&json);
+        jenson::JenSON::setParallelThreshold(0);
+        QCOMPARE(parallelScope.total().objects, quint64(6));
+        QCOMPARE(parallelScope.stats("SingleProperty").objects, quint64(3));
+    }
+
+    // Nothing is counted without a scope
+    jenson::AllocationScope empty;
+    QCOMPARE(empty.total().allocations, quint64(0));
+}
+
+void JensonTests::testTimingStats()
+{
+    Testobject p(1, 2);
+    CustomContainer c;
+
+    // Nothing is recorded while disabled
+    QVERIFY(!jenson::JenSON::isStatsEnabled());
+    jenson::JenSON::resetStats();
+    jenson::JenSON::serialize(&p);
+    QVERIFY(jenson::JenSON::stats().isEmpty());
+
+    jenson::JenSON::setStatsEnabled(true);
+    QJsonObject json = jenson::JenSON::serialize(&p);
+    sptr<QObject> o = jenson::JenSON::deserializeToObject(&json);
+    QJsonObject customJson = jenson::JenSON::serialize(&c);
+    sptr<QObject> custom = jenson::JenSON::deserializeToObject(&customJson);
+
+    QHash<QString, jenson::ClassStats> stats = jenson::JenSON::stats();
+    const jenson::OperationStats &serialized = stats.value("tObj").serialize;
+    QCOMPARE(serialized.calls, quint64(1));
+    QCOMPARE(stats.value("tObj").deserialize.calls, quint64(1));
+    QCOMPARE(stats.value("sProp").deserialize.calls, quint64(3));
+    QVERIFY(serialized.totalNs >= serialized.selfNs);
+    QCOMPARE(serialized.maxNs, serialized.totalNs);
+    QCOMPARE(stats.value("cserial").customSerialize.calls, quint64(1));
+    QCOMPARE(stats.value("cserial").customDeserialize.calls, quint64(1));
+    QCOMPARE(stats.value("cserial").serialize.calls, quint64(0));
+
+    // The streaming methods count the produced and consumed bytes
+    jenson::JenSON::resetStats();
+    QByteArray bytes;
+    jenson::JenSON::serialize(&p, &bytes);
+    sptr<QObject> streamed = jenson::JenSON::deserializeFrom(bytes);
+    stats = jenson::JenSON::stats();
+    QCOMPARE(stats.value("tObj").serialize.calls, quint64(1));
+    QVERIFY(stats.value("tObj").serialize.bytes > 0);
+    QVERIFY(stats.value("tObj").serialize.bytes <= bytes.size());
+    QVERIFY(stats.value("tObj").deserialize.bytes > 0);
+    QVERIFY(stats.value("tObj").deserialize.bytes <= bytes.size());
+    QVERIFY(stats.value("nObj").serialize.bytes < stats.value("tObj").serialize.bytes);
+
+    // Objects built on pool threads are counted and excluded from the self time of their parents
+    jenson::JenSON::resetStats();
+    jenson::JenSON::setParallelThreshold(2);
+    sptr<QObject> parallel = jenson::JenSON::deserializeToObject(&json);
+    jenson::JenSON::setParallelThreshold(0);
+    jenson::JenSON::deserializeAsync<Testobject>(bytes).waitForFinished();
+    stats = jenson::JenSON::stats();
+    QCOMPARE(stats.value("tObj").deserialize.calls, quint64(2));
+    QCOMPARE(stats.value("sProp").deserialize.calls, quint64(6));
+    QVERIFY(stats.value("tObj").deserialize.selfNs + stats.value("nObj").deserialize.maxNs <= stats.value("tObj").deserialize.totalNs);
+
+    jenson::JenSON::setStatsEnabled(false);
+    jenson::JenSON::resetStats();
+    QVERIFY(jenson::JenSON::stats().isEmpty());
+
+    // Chrome trace events, drained by writeChromeTrace
+    jenson::JenSON::setTraceEnabled(true);
+    jenson::JenSON::serialize(&p);
+    jenson::JenSON::setTraceEnabled(false);
+    QVERIFY(jenson::JenSON::stats().isEmpty());
+
+    QBuffer trace;
+    trace.open(QIODevice::WriteOnly);
+    QVERIFY(jenson::JenSON::writeChromeTrace(&trace));
+    QJsonArray events = QJsonDocument::fromJson(trace.data()).object().value("traceEvents").toArray();
+    QVERIFY(events.count() >= 5);
+    bool found = false;
+    foreach (const QJsonValue &event, events)
+    {
+        QCOMPARE(event.toObject().value("ph").toString(), QString("X"));
+        if (event.toObject().value("name").toString() == "tObj")
+        {
+            QCOMPARE(event.toObject().value("cat").toString(), QString("serialize"));
+            found = true;
+        }
+    }
+    QVERIFY(found);
+
+    QBuffer drained;
+    drained.open(QIODevice::WriteOnly);
+    QVERIFY(jenson::JenSON::writeChromeTrace(&drained));
+    QVERIFY(QJsonDocument::fromJson(drained.data()).object().value("traceEvents").toArray().isEmpty());
+}
+
+void JensonTests::testTypedContainers()
+{
+    TypedContainers containers;
+    QList<SingleProperty*> items;
+    items << new SingleProperty() << nullptr << new DerivedSingleProperty();
+    QVector<Nestedobject*> nested;
+    for (int i = 0; i < 3; i++)
+    {
+        nested << new Nestedobject();
+        nested.last()->setSomeString(QString::number(i));
+    }
+    QList<CustomSerializable*> customs;
+    customs << new CustomSerializable();
+    customs.last()->x = 9;
+    foreach (QObject *obj, QList<QObject*>() << items.first() << items.last() << customs.first())
+        obj->setParent(&containers);
+    foreach (Nestedobject *obj, nested)
+        obj->setParent(&containers);
+    containers.setitems(items);
+    containers.setnested(nested);
+    containers.setcustoms(customs);
+
+    // Elements are plain objects of the declared class, without serial name wrapper
+    QJsonObject json = jenson::JenSON::serialize(&containers);
+    QJsonObject props = json.value("tContainers").toObject();
+    QJsonArray jsonItems = props.value("items").toArray();
+    QCOMPARE(jsonItems.count(), 3);
+    QCOMPARE(jsonItems.at(0).toObject().value("someUuid").toString(), items.first()->someUuid().toString());
+    QVERIFY(jsonItems.at(1).isNull());
+    QCOMPARE(props.value("nested").toArray().at(2).toObject().value("someString").toString(), QString("2"));
+    QCOMPARE(props.value("customs").toArray().at(0).toObject().value("custom").toDouble(), 4.5);
+
+    sptr<TypedContainers> ds = jenson::JenSON::deserialize<TypedContainers>(&json);
+    QCOMPARE(ds->items().count(), 3);
+    QCOMPARE(ds->items().first()->someUuid(), items.first()->someUuid());
+    QVERIFY(ds->items().at(1) == nullptr);
+    QCOMPARE(ds->items().last()->parent(), ds.get());
+    QCOMPARE(ds->nested().count(), 3);
+    QCOMPARE(ds->nested().at(1)->someString(), QString("1"));
+    QCOMPARE(ds->customs().first()->x, 9.5);
+
+    // Streaming writes and reads the same Json
+    QByteArray bytes;
+    jenson::JenSON::serialize(&containers, &bytes);
+    QCOMPARE(QJsonDocument::fromJson(bytes).object(), json);
+
+    sptr<QObject> streamed = jenson::JenSON::deserializeFrom(bytes);
+    TypedContainers *sContainers = qobject_cast<TypedContainers*>(streamed.get());
+    QCOMPARE(sContainers->items().count(), 3);
+    QCOMPARE(sContainers->items().last()->someUuid(), items.last()->someUuid());
+    QCOMPARE(sContainers->nested().at(2)->someString(), QString("2"));
+    QCOMPARE(sContainers->customs().first()->x, 9.5);
+
+    // Values that are not arrays fail like any unconvertible value
+    QString errorMsg;
+    props.insert("items", QJsonObject());
+    json.insert("tContainers", props);
+    QVERIFY(jenson::JenSON::deserialize<TypedContainers>(&json, &errorMsg) == nullptr);
+    QVERIFY(jenson::JenSON::deserializeFrom(QJsonDocument(json).toJson(), &errorMsg) == nullptr);
+}
+
+void JensonTests::testColumnarContainers()
+{
+    ColumnarTable table;
+    QVector<PreciseValues*> rows;
+    for (int i = 0; i < 3; i++)
+    {
+        PreciseValues *row = new PreciseValues();
+        row->setParent(&table);
+        row->setshortest(i + 0.1);
+        row->setrounded(1.23456);
+        row->setpoints(QVector<double>() << i << 0.5);
+        rows << row;
+    }
+    QList<SingleProperty*> sparse;
+    sparse << new SingleProperty() << nullptr;
+    sparse.first()->setParent(&table);
+    table.setrows(rows);
+    table.setsparse(sparse);
+
+    // One array per property, containers with null elements are written as rows
+    QJsonObject json = jenson::JenSON::serialize(&table);
+    QJsonObject props = json.value("cTable").toObject();
+    QJsonObject columnar = props.value("rows").toObject();
+    QCOMPARE(columnar.value("class").toString(), QString("pValues"));
+    QCOMPARE(columnar.value("count").toInt(), 3);
+    QJsonObject columns = columnar.value("columns").toObject();
+    QCOMPARE(columns.value("shortest").toArray(), QJsonArray() << 0.1 << 1.1 << 2.1);
+    QCOMPARE(columns.value("rounded").toArray().at(2).toDouble(), 1.23);
+    QCOMPARE(columns.value("points").toArray().at(1).toArray(), QJsonArray() << 1 << 0.5);
+    QVERIFY(props.value("sparse").isArray());
+
+    sptr<ColumnarTable> ds = jenson::JenSON::deserialize<ColumnarTable>(&json);
+    QCOMPARE(ds->rows().count(), 3);
+    QCOMPARE(ds->rows().at(2)->shortest(), 2.1);
+    QCOMPARE(ds->rows().at(0)->rounded(), 1.23);
+    QCOMPARE(ds->rows().at(1)->points(), rows.at(1)->points());
+    QCOMPARE(ds->rows().at(1)->parent(), ds.get());
+    QCOMPARE(ds->sparse().count(), 2);
+
+    // Streaming writes the same Json and reads the columns in place, also when the count follows them
+    QByteArray bytes;
+    jenson::JenSON::serialize(&table, &bytes);
+    QCOMPARE(QJsonDocument::fromJson(bytes).object(), json);
+
+    foreach (const QByteArray &data, QList<QByteArray>() << bytes << QJsonDocument(json).toJson())
+    {
+        sptr<QObject> streamed = jenson::JenSON::deserializeFrom(data);
+        ColumnarTable *sTable = qobject_cast<ColumnarTable*>(streamed.get());
+        QVERIFY(sTable);
+        QCOMPARE(sTable->rows().count(), 3);
+        QCOMPARE(sTable->rows().at(1)->shortest(), 1.1);
+        QCOMPARE(sTable->rows().at(2)->points(), rows.at(2)->points());
+        QCOMPARE(sTable->sparse().count(), 2);
+    }
+
+    // Columns of another length than the count are rejected
+    QString errorMsg;
+    columns.insert("shortest", QJsonArray() << 0.1);
+    columnar.insert("columns", columns);
+    props.insert("rows", columnar);
+    json.insert("cTable", props);
+    QVERIFY(jenson::JenSON::deserialize<ColumnarTable>(&json, &errorMsg) == nullptr);
+    QVERIFY(jenson::JenSON::deserializeFrom(QJsonDocument(json).toJson(), &errorMsg) == nullptr);
+}
+
+void JensonTests::testFileMethods()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + "/testobject.json";
+
+    Testobject p(1, 2);
+    QByteArray bytes;
+    jenson::JenSON::serialize(&p, &bytes);
+
+    // Written like the streaming serializer
+    jenson::JenSON::serializeFile(&p, path);
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), bytes);
+    file.close();
+
+    sptr<QObject> o = jenson::JenSON::deserializeFile(path);
+    Testobject *t = qobject_cast<Testobject*>(o.get());
+    QVERIFY(t);
+    QCOMPARE(t->x(), p.x());
+    QCOMPARE(t->list().count(), p.list().count());
+
+#ifdef JENSON_CBOR
+    const QString cborPath = dir.path() + "/testobject.cbor";
+    QVERIFY(jenson::JenSON::serializeFile(&p, cborPath, nullptr, jenson::JenSON::Cbor));
+    QVERIFY(qobject_cast<Testobject*>(jenson::JenSON::deserializeFile(cborPath, jenson::JenSON::Cbor).get()));
+#endif
+
+    // Saving into a missing directory fails
+    QString errorMsg;
+    QVERIFY(!jenson::JenSON::serializeFile(&p, dir.path() + "/missing/testobject.json", &errorMsg));
+    QVERIFY(errorMsg.contains("missing"));
+
+    errorMsg.clear();
+    QVERIFY(jenson::JenSON::deserializeFile(dir.path() + "/missing.json", &errorMsg) == nullptr);
+    QVERIFY(!errorMsg.isEmpty());
+
+    // Empty and truncated files are parse errors
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(bytes.left(bytes.size() / 2));
+    file.close();
+    QVERIFY(jenson::JenSON::deserializeFile(path, &errorMsg) == nullptr);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.close();
+    QVERIFY(jenson::JenSON::deserializeFile(path, &errorMsg) == nullptr);
+}
+
+void JensonTests::testAsyncMethods()
+{
+    Testobject p(1, 2);
+    QByteArray bytes;
+    jenson::JenSON::serialize(&p, &bytes);
+
+    // Deserialized objects are handed over to the calling thread
+    QFuture<jenson::shptr<Testobject>> future = jenson::JenSON::deserializeAsync<Testobject>(bytes);
+    future.waitForFinished();
+    jenson::shptr<Testobject> t = future.result();
+    QVERIFY(t != nullptr);
+    QCOMPARE(t->x(), p.x());
+    QCOMPARE(t->list().count(), p.list().count());
+    QCOMPARE(t->thread(), QThread::currentThread());
+    QCOMPARE(future.progressValue(), future.progressMaximum());
+    QCOMPARE(future.progressMaximum(), bytes.size());
+
+    QCOMPARE(jenson::JenSON::serializeAsync(&p).result(), bytes);
+
+    // serializeAsync encodes a snapshot, the object can change or go away right after the call
+    Testobject *changing = new Testobject(3, 4);
+    QByteArray changingBytes;
+    jenson::JenSON::serialize(changing, &changingBytes);
+    QFuture<QByteArray> serialized = jenson::JenSON::serializeAsync(changing);
+    changing->setx(5);
+    delete changing;
+    QCOMPARE(serialized.result(), changingBytes);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + "/testobject.json";
+    jenson::JenSON::serializeFile(&p, path);
+    QVERIFY(jenson::JenSON::deserializeFileAsync<Testobject>(path).result() != nullptr);
+
+    // Failed futures rethrow the SerializationException
+    bool thrown = false;
+    try { jenson::JenSON::deserializeAsync(bytes.left(bytes.size() / 2)).waitForFinished(); }
+    catch (const jenson::SerializationException &e) { thrown = !e.message().isEmpty(); }
+    QVERIFY(thrown);
+
+    thrown = false;
+    try { jenson::JenSON::deserializeAsync<NumericArrays>(bytes).waitForFinished(); }
+    catch (const jenson::SerializationException &e) { thrown = e.message().contains("NumericArrays"); }
+    QVERIFY(thrown);
+
+    thrown = false;
+    try { jenson::JenSON::deserializeFileAsync(dir.path() + "/missing.json").waitForFinished(); }
+    catch (const jenson::SerializationException &) { thrown = true; }
+    QVERIFY(thrown);
+}
+
+void JensonTests::testParallelDeserialization()
+{
+    Testobject p(1, 2);
+    QJsonObject json = jenson::JenSON::serialize(&p);
+
+    TypedContainers containers;
+    QVector<Nestedobject*> nested;
+    for (int i = 0; i < 5; i++)
+    {
+        nested << new Nestedobject();
+        nested.last()->setSomeString(QString::number(i));
+        nested.last()->setParent(&containers);
+    }
+    containers.setnested(nested);
+    QJsonObject containersJson = jenson::JenSON::serialize(&containers);
+
+    // Lists, typed containers and both nested objects of Testobject are split across the pool
+    jenson::JenSON::setParallelThreshold(2);
+    QCOMPARE(jenson::JenSON::parallelThreshold(), 2);
+    sptr<Testobject> t = jenson::JenSON::deserialize<Testobject>(&json);
+    sptr<TypedContainers> c = jenson::JenSON::deserialize<TypedContainers>(&containersJson);
+    jenson::JenSON::setParallelThreshold(0);
+
+    QCOMPARE(t->singleProp()->someUuid(), p.singleProp()->someUuid());
+    QCOMPARE(t->singleProp()->parent(), t.get());
+    QCOMPARE(t->singleProp()->thread(), QThread::currentThread());
+    QCOMPARE(t->nestedObj()->parent(), t.get());
+    QCOMPARE(t->nestedObj()->thread(), QThread::currentThread());
+    QCOMPARE(t->list().count(), p.list().count());
+    for (int i = 0; i < p.list().count(); i++)
+    {
+        SingleProperty *item = t->list().at(i).value<SingleProperty*>();
+        QCOMPARE(item->someUuid(), p.list().at(i).value<SingleProperty*>()->someUuid());
+        QCOMPARE(item->metaObject(), p.list().at(i).value<SingleProperty*>()->metaObject());
+        QCOMPARE(item->thread(), QThread::currentThread());
+    }
+    QCOMPARE(t->intList(), p.intList());
+
+    QCOMPARE(c->nested().count(), nested.count());
+    for (int i = 0; i < nested.count(); i++)
+    {
+        QCOMPARE(c->nested().at(i)->someString(), QString::number(i));
+        QCOMPARE(c->nested().at(i)->parent(), c.get());
+        QCOMPARE(c->nested().at(i)->thread(), QThread::currentThread());
+    }
+
+    // Failures are reported like the sequential ones
+    QJsonObject props = containersJson.value("tContainers").toObject();
+    QJsonObject badItem;
+    badItem.insert("someUuid", QJsonObject());
+    QJsonArray badItems;
+    badItems << badItem << badItem;
+    props.insert("items", badItems);
+    containersJson.insert("tContainers", props);
+    jenson::JenSON::setParallelThreshold(2);
+    QString errorMsg;
+    QVERIFY(jenson::JenSON::deserialize<TypedContainers>(&containersJson, &errorMsg) == nullptr);
+    QVERIFY(errorMsg.contains("someUuid"));
+    jenson::JenSON::setParallelThreshold(0);
+}
+
+void JensonTests::testImmediateDelete()
+{
+#if !defined(JENSON_QPTR) || defined(QPTR_IMMEDIATE_DELETE)
+    Testobject p(1, 2);
+    QJsonObject json = jenson::JenSON::serialize(&p);
+
+    // Dropped graphs are deleted without running the eventloop
+    sptr<Testobject> t = jenson::JenSON::deserialize<Testobject>(&json);
+    QList<QObject*> graph;
+    graph << t.get() << t->nestedObj() << t->singleProp();
+    t.reset();
+    foreach (QObject *obj, graph)
+        QVERIFY(!objectCounter().objList.contains(obj));
+
+    // Also when built on pool threads and handed over to this one
+    jenson::JenSON::setParallelThreshold(2);
+    t = jenson::JenSON::deserialize<Testobject>(&json);
+    jenson::JenSON::setParallelThreshold(0);
+    graph.clear();
+    graph << t.get() << t->nestedObj() << t->singleProp();
+    t.reset();
+    foreach (QObject *obj, graph)
+        QVERIFY(!objectCounter().objList.contains(obj));
+#endif
+}
+
+void JensonTests::testGeneratedFields()
+{
+#ifdef JENSON_CODEGEN
+    // jenson-gen covers the JENSON_PROPERTY_GETSET classes without JENSON_FIELDS
+    QVERIFY(jenson::JenSON::hasGeneratedFields(jenson::JenSON::typeHandle(&TrackedObject::staticMetaObject)));
+    QVERIFY(jenson::JenSON::hasGeneratedFields(jenson::JenSON::typeHandle(&PreciseValues::staticMetaObject)));
+    QVERIFY(!jenson::JenSON::hasGeneratedFields(jenson::JenSON::typeHandle(&TypedObject::staticMetaObject)));
+    QVERIFY(!jenson::JenSON::hasGeneratedFields(jenson::JenSON::typeHandle(&NumericArrays::staticMetaObject)));
+#else
+    // Without generated fields both passes below would take the reflective path
+    QSKIP("Built without jenson-gen, configure with -DCodegen=ON");
+#endif
+
+    TrackedObject tracked;
+    tracked.seta(1.5);
+    tracked.setb("b");
+    tracked.child()->setvalue(-2);
+    tracked.setuntracked(3);
+
+    ArenaNode node;
+    ArenaLeaf leaf;
+    leaf.setvalue(0.25);
+    node.setleaf(&leaf);
+
+    ColumnarTable table;
+    QVector<PreciseValues*> rows;
+    for (int i = 0; i < 3; i++)
+    {
+        PreciseValues *row = new PreciseValues();
+        row->setParent(&table);
+        row->setshortest(i + 0.1);
+        row->setrounded(1.23456);
+        rows << row;
+    }
+    table.setrows(rows);
+
+    // The generated and the reflective path write and read the same Json
+    foreach (const QObject *obj, QList<const QObject*>() << &tracked << &node << rows.first() << &table)
+    {
+        QVERIFY(jenson::JenSON::isGeneratedFieldsEnabled());
+        QJsonObject json = jenson::JenSON::serialize(obj);
+        QByteArray bytes;
+        jenson::JenSON::serialize(obj, &bytes);
+        QJsonObject roundTrip = jenson::JenSON::serialize(jenson::JenSON::deserializeToObject(&json).get());
+        QJsonObject streamed = jenson::JenSON::serialize(jenson::JenSON::deserializeFrom(bytes).get());
+
+        jenson::JenSON::setGeneratedFieldsEnabled(false);
+        QCOMPARE(jenson::JenSON::serialize(obj), json);
+        QByteArray reflectiveBytes;
+        jenson::JenSON::serialize(obj, &reflectiveBytes);
+        QCOMPARE(reflectiveBytes, bytes);
+        QCOMPARE(jenson::JenSON::serialize(jenson::JenSON::deserializeToObject(&json).get()), roundTrip);
+        QCOMPARE(jenson::JenSON::serialize(jenson::JenSON::deserializeFrom(bytes).get()), streamed);
+        jenson::JenSON::setGeneratedFieldsEnabled(true);
+    }
+}
+
+void JensonTests::testRegistryFreeze()
+{
+    jenson::JenSON::freezeRegistry();
+    QVERIFY(jenson::JenSON::isRegistryFrozen());
+
+    // Lookups keep working on the frozen snapshot
+    SingleProperty sProp;
+    QJsonObject json = jenson::JenSON::serialize(&sProp);
+    sptr<SingleProperty> ds = jenson::JenSON::deserialize<SingleProperty>(&json);
+    QCOMPARE(ds->someUuid(), sProp.someUuid());
+
+    // Late registration publishes a new snapshot, references to the old one stay valid
+    const QMap<QString, const QObject*> &oldMap = jenson::JenSON::typeMap();
+    QVERIFY(!oldMap.contains("LateRegistered"));
+    jenson::JenSON::registerForSerialization<LateRegistered> late("late");
+    QVERIFY(!oldMap.contains("LateRegistered"));
+    QVERIFY(jenson::JenSON::typeMap().contains("LateRegistered"));
+
+    LateRegistered lProp;
+    json = jenson::JenSON::serialize(&lProp);
+    QVERIFY(json.contains("late"));
+    sptr<LateRegistered> dl = jenson::JenSON::deserialize<LateRegistered>(&json);
+    QCOMPARE(dl->someUuid(), lProp.someUuid());
+
+    // Freezing twice is a no-op
+    jenson::JenSON::freezeRegistry();
+    QVERIFY(jenson::JenSON::typeMap().contains("LateRegistered"));
+}
+
 cntr::~cntr()
 {
     if (objList.count() > 0)
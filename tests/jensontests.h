@@ -23,6 +23,7 @@
 #ifndef JENSONTESTS_H
 #define JENSONTESTS_H
 
+#include <QMutex>
 #include <QObject>
 #include <QUuid>
 #include "src/jenson.h"
@@ -37,6 +38,31 @@ private slots:
     void testCustomSerialization();
     void testSerializationFailures();
     void testOnDeserialized();
+    void testStreamingSerialization();
+    void testStreamingDeserialization();
+    void testCborSerialization();
+    void testBatchSerialization();
+    void testTypeHandles();
+    void testTypedFields();
+    void testArenaAllocation();
+    void testDeserializeInto();
+    void testDeltaSerialization();
+    void testLazyDeserialization();
+    void testNumericArrays();
+    void testInputScanning();
+    void testNumberFormatting();
+    void testAllocationStats();
+    void testTimingStats();
+    void testTypedContainers();
+    void testColumnarContainers();
+    void testFileMethods();
+    void testAsyncMethods();
+    void testParallelDeserialization();
+    void testImmediateDelete();
+    void testGeneratedFields();
+
+    // Freezes the process wide registry, keep it last so the other tests run against an unfrozen one
+    void testRegistryFreeze();
 };
 
 
@@ -46,14 +72,21 @@ private slots:
 
 struct cntr
 {
+    QMutex mutex; // Objects are created and deleted on pool threads too
     QList<QObject*> objList;
     bool enabled = false;
-    void inc(QObject* obj) { if (enabled) objList.append(obj); }
-    void dec(QObject* obj) { objList.removeAll(obj); }
+    void inc(QObject* obj) { QMutexLocker locker(&mutex); if (enabled) objList.append(obj); }
+    void dec(QObject* obj) { QMutexLocker locker(&mutex); objList.removeAll(obj); }
     ~cntr();
 };
 
-static cntr OBJ_CNT;
+// One counter for all translation units including this header (moc and jenson-gen outputs too),
+// constructed on first use so it outlives the SERIALIZABLE prototypes
+inline cntr& objectCounter()
+{
+    static cntr counter;
+    return counter;
+}
 
 
 //
@@ -67,9 +100,9 @@ class CustomSerializable : public QObject
 public:
     qreal x;
 
-    CustomSerializable() : x(5) { OBJ_CNT.inc(this); }
+    CustomSerializable() : x(5) { objectCounter().inc(this); }
 
-    virtual ~CustomSerializable() { OBJ_CNT.dec(this); }
+    virtual ~CustomSerializable() { objectCounter().dec(this); }
 };
 
 class CustomSerializableSerializer : public jenson::JenSON::CustomSerializer<CustomSerializable>
@@ -102,11 +135,11 @@ private:
     sptr<CustomSerializable> _nested;
 
 public:
-    Q_INVOKABLE CustomContainer() { _nested.reset(new CustomSerializable()); OBJ_CNT.inc(this); }
+    Q_INVOKABLE CustomContainer() { _nested.reset(new CustomSerializable()); objectCounter().inc(this); }
     CustomSerializable* nested() { return _nested.get(); }
     void setNested(CustomSerializable* nested) { _nested.reset(nested); }
 
-    virtual ~CustomContainer() { OBJ_CNT.dec(this); }
+    virtual ~CustomContainer() { objectCounter().dec(this); }
 };
 SERIALIZABLE(CustomContainer, cContainer)
 
@@ -122,9 +155,9 @@ private:
     int _random;
 
 public:
-    Q_INVOKABLE Nestedobject() { _random = (int)this; OBJ_CNT.inc(this); }
+    Q_INVOKABLE Nestedobject() { _random = (int)this; objectCounter().inc(this); }
 
-    virtual ~Nestedobject() { OBJ_CNT.dec(this); }
+    virtual ~Nestedobject() { objectCounter().dec(this); }
 
     QString someString() const { return _someString; }
     int random() const { return _random; }
@@ -143,9 +176,9 @@ private:
     QUuid _someUuid;
 
 public:
-    Q_INVOKABLE SingleProperty() { _someUuid = QUuid::createUuid(); OBJ_CNT.inc(this); }
+    Q_INVOKABLE SingleProperty() { _someUuid = QUuid::createUuid(); objectCounter().inc(this); }
 
-    virtual ~SingleProperty() { OBJ_CNT.dec(this); }
+    virtual ~SingleProperty() { objectCounter().dec(this); }
 
     QUuid someUuid() const { return _someUuid; }
 
@@ -158,9 +191,9 @@ class DerivedSingleProperty : public SingleProperty
     Q_OBJECT
 
 public:
-    Q_INVOKABLE DerivedSingleProperty() : SingleProperty() { OBJ_CNT.inc(this); }
+    Q_INVOKABLE DerivedSingleProperty() : SingleProperty() { objectCounter().inc(this); }
 
-    virtual ~DerivedSingleProperty() { OBJ_CNT.dec(this); }
+    virtual ~DerivedSingleProperty() { objectCounter().dec(this); }
 };
 SERIALIZABLE(DerivedSingleProperty, dProp)
 
@@ -169,15 +202,204 @@ class OnDeserialized : public SingleProperty
     Q_OBJECT
 
 public:
-    Q_INVOKABLE OnDeserialized() : SingleProperty() { OBJ_CNT.inc(this); }
+    Q_INVOKABLE OnDeserialized() : SingleProperty() { objectCounter().inc(this); }
 
     bool _onDeserializedCalled = false;
     Q_INVOKABLE void onDeserialized() { _onDeserializedCalled = true; }
 
-    virtual ~OnDeserialized() { OBJ_CNT.dec(this); }
+    virtual ~OnDeserialized() { objectCounter().dec(this); }
 };
 SERIALIZABLE(OnDeserialized, onDeserial)
 
+class ArenaLeaf : public QObject
+{
+    Q_OBJECT
+    JENSON_ARENA_ALLOCATED
+
+    JENSON_PROPERTY_GETSET(qreal, value)
+
+public:
+    Q_INVOKABLE ArenaLeaf() : _value(0) { objectCounter().inc(this); }
+
+    virtual ~ArenaLeaf() { objectCounter().dec(this); }
+};
+SERIALIZABLE(ArenaLeaf, aLeaf)
+
+class ArenaNode : public QObject
+{
+    Q_OBJECT
+    JENSON_ARENA_ALLOCATED
+
+    JENSON_PROPERTY_GETSET(ArenaLeaf*, leaf)
+
+public:
+    Q_INVOKABLE ArenaNode() : _leaf(nullptr) { objectCounter().inc(this); }
+
+    virtual ~ArenaNode() { objectCounter().dec(this); }
+};
+SERIALIZABLE(ArenaNode, aNode)
+
+class TrackedChild : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET_NOTIFY(qreal, value)
+
+public:
+    Q_INVOKABLE TrackedChild() : _value(0) { objectCounter().inc(this); }
+
+    virtual ~TrackedChild() { objectCounter().dec(this); }
+};
+SERIALIZABLE(TrackedChild, tChild)
+
+class TrackedObject : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET_NOTIFY(qreal, a)
+    JENSON_PROPERTY_GETSET_NOTIFY(QString, b)
+    JENSON_PROPERTY_GETSET_NOTIFY(TrackedChild*, child)
+    JENSON_PROPERTY_GETSET(qreal, untracked)
+
+public:
+    Q_INVOKABLE TrackedObject() : _a(0), _child(new TrackedChild()), _untracked(0)
+        { _child->setParent(this); objectCounter().inc(this); }
+
+    virtual ~TrackedObject() { objectCounter().dec(this); }
+};
+SERIALIZABLE(TrackedObject, tTracked)
+
+class LazyHolder : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(qreal, x)
+    JENSON_LAZY_PROPERTY(Nestedobject, lazyNested)
+
+public:
+    Q_INVOKABLE LazyHolder() : _x(0) { objectCounter().inc(this); }
+
+    virtual ~LazyHolder() { objectCounter().dec(this); }
+
+    bool isPending() const { return _lazyNested.isPending(); }
+};
+SERIALIZABLE(LazyHolder, lHolder)
+
+class NumericArrays : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(QVector<double>, doubles)
+    JENSON_PROPERTY_GETSET(QVector<float>, floats)
+    JENSON_PROPERTY_GETSET(QVector<int>, ints)
+
+public:
+    Q_INVOKABLE NumericArrays() { objectCounter().inc(this); }
+
+    virtual ~NumericArrays() { objectCounter().dec(this); }
+};
+SERIALIZABLE(NumericArrays, nArrays)
+
+class PreciseValues : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(qreal, shortest)
+    JENSON_PROPERTY_GETSET(qreal, rounded)
+    JENSON_PROPERTY_GETSET(QVector<double>, points)
+    JENSON_PROPERTY_GETSET(QVector<float>, floats)
+
+    // Fixed precision properties
+    JENSON_PRECISION(rounded, 2)
+    JENSON_PRECISION(points, 3)
+
+public:
+    Q_INVOKABLE PreciseValues() : _shortest(0), _rounded(0) { objectCounter().inc(this); }
+
+    virtual ~PreciseValues() { objectCounter().dec(this); }
+};
+SERIALIZABLE(PreciseValues, pValues)
+
+class NonFiniteValues : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(qreal, number)
+    JENSON_PROPERTY_GETSET(float, single)
+    JENSON_PROPERTY_GETSET(QVector<double>, doubles)
+    JENSON_PROPERTY_GETSET(QVector<float>, floats)
+
+public:
+    Q_INVOKABLE NonFiniteValues() : _number(0), _single(0) { objectCounter().inc(this); }
+
+    virtual ~NonFiniteValues() { objectCounter().dec(this); }
+};
+SERIALIZABLE(NonFiniteValues, nfValues)
+
+// The elements are children of the container object
+class TypedContainers : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(QList<SingleProperty*>, items)
+    JENSON_PROPERTY_GETSET(QVector<Nestedobject*>, nested)
+    JENSON_PROPERTY_GETSET(QList<CustomSerializable*>, customs)
+
+public:
+    Q_INVOKABLE TypedContainers() { objectCounter().inc(this); }
+
+    virtual ~TypedContainers() { objectCounter().dec(this); }
+};
+SERIALIZABLE(TypedContainers, tContainers)
+
+class ColumnarTable : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(QVector<PreciseValues*>, rows)
+    JENSON_PROPERTY_GETSET(QList<SingleProperty*>, sparse)
+
+    JENSON_COLUMNAR(rows)
+    JENSON_COLUMNAR(sparse)
+
+public:
+    Q_INVOKABLE ColumnarTable() { objectCounter().inc(this); }
+
+    virtual ~ColumnarTable() { objectCounter().dec(this); }
+};
+SERIALIZABLE(ColumnarTable, cTable)
+
+// Registered after freezing the registry in testRegistryFreeze
+class LateRegistered : public SingleProperty
+{
+    Q_OBJECT
+
+public:
+    Q_INVOKABLE LateRegistered() : SingleProperty() { objectCounter().inc(this); }
+
+    virtual ~LateRegistered() { objectCounter().dec(this); }
+};
+Q_DECLARE_METATYPE(LateRegistered *)
+
+class TypedObject : public QObject
+{
+    Q_OBJECT
+
+    JENSON_PROPERTY_GETSET(qreal, x)
+    JENSON_PROPERTY_GETSET(Nestedobject*, nestedObj)
+    JENSON_PROPERTY_GETSET(qreal, y)
+
+    // Typed (de)serialization of x and nestedObj, y uses QVariant
+    JENSON_FIELDS(TypedObject, JENSON_FIELD(x), JENSON_FIELD(nestedObj))
+
+public:
+    Q_INVOKABLE TypedObject() : _x(0), _nestedObj(new Nestedobject()), _y(0)
+        { _nestedObj->setParent(this); objectCounter().inc(this); }
+
+    virtual ~TypedObject() { objectCounter().dec(this); }
+};
+SERIALIZABLE(TypedObject, tTyped)
+
 class Testobject : public QObject
 {
     Q_OBJECT
@@ -217,10 +439,10 @@ private:
     }
 
 public:
-    Q_INVOKABLE Testobject() : _x(0), _y(0), _optionalStr("") { init(); OBJ_CNT.inc(this); }
-    Testobject(qreal x, qreal y) : _x(x), _y(y), _optionalStr("") { init(); OBJ_CNT.inc(this); }
+    Q_INVOKABLE Testobject() : _x(0), _y(0), _optionalStr("") { init(); objectCounter().inc(this); }
+    Testobject(qreal x, qreal y) : _x(x), _y(y), _optionalStr("") { init(); objectCounter().inc(this); }
 
-    virtual ~Testobject() { OBJ_CNT.dec(this); }
+    virtual ~Testobject() { objectCounter().dec(this); }
 
     QList<std::shared_ptr<SingleProperty>> *internalList() { return &_list; }
 
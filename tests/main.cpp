@@ -23,6 +23,10 @@
 #include <QCoreApplication>
 
 #include "submodules/qtestrunner/qtestrunner.hpp"
+#include "src/jenson_stats.h"
+
+// Heap allocation counts of jenson::AllocationScope
+JENSON_TRACK_HEAP_ALLOCATIONS
 
 int main(int argc, char *argv[])
 {